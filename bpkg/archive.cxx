@@ -3,6 +3,8 @@
 
 #include <bpkg/archive.hxx>
 
+#include <cstring> // strcmp(), memcmp(), memchr()
+
 #include <bpkg/utility.hxx>
 #include <bpkg/diagnostics.hxx>
 
@@ -33,8 +35,11 @@ namespace bpkg
 
   // Only the extract ('x') and list ('t') operations are supported.
   //
+  // If mt is true, then prefer the multi-threaded decompressor, if
+  // available (see start_extract() for details).
+  //
   static pair<cstrings, size_t>
-  start (const common_options& co, char op, const path& a)
+  start (const common_options& co, char op, const path& a, bool mt = false)
   {
     assert (op == 'x' || op == 't');
 
@@ -85,7 +90,34 @@ namespace bpkg
 #ifdef _WIN32
       if (!bsdtar (tar))
 #endif
+      {
+        // Note that, as for bsdtar on OpenBSD, the lookup result is thrown
+        // away but this is nothing compared to the decompression time of a
+        // large archive.
+        //
+        if (mt && d != nullptr)
+        {
+          if (strcmp (d, "gzip") == 0)
+          {
+            if (!process::try_path_search ("pigz", true).empty ())
+              d = "pigz";
+          }
+          else if (strcmp (d, "bzip2") == 0)
+          {
+            if (!process::try_path_search ("lbzip2", true).empty ())
+              d = "lbzip2";
+          }
+        }
+
         args.push_back (d);
+
+        // Note that xz only decompresses in parallel the multi-block
+        // archives (produced with -T, for example) and ignores the option
+        // otherwise (or prior to 5.4.0).
+        //
+        if (mt && d != nullptr && strcmp (d, "xz") == 0)
+          args.push_back ("-T0");
+      }
     }
 
     size_t i (0); // The tar command line start.
@@ -123,7 +155,7 @@ namespace bpkg
   pair<process, process>
   start_extract (const common_options& co, const path& a, const dir_path& d)
   {
-    pair<cstrings, size_t> args_i (start (co, 'x', a));
+    pair<cstrings, size_t> args_i (start (co, 'x', a, true /* mt */));
     cstrings& args (args_i.first);
     size_t i (args_i.second);
 
@@ -395,4 +427,380 @@ namespace bpkg
     //
     fail << "unable to obtain contents for " << a << ": " << e << endf;
   }
+
+  // Parse the octal number tar header field. Return nullopt if the field is
+  // malformed or uses the (GNU) base-256 encoding.
+  //
+  static optional<uint64_t>
+  tar_octal (const char* s, size_t n)
+  {
+    size_t i (0);
+    for (; i != n && (s[i] == ' ' || s[i] == '\0'); ++i) ;
+
+    if (i == n)
+      return 0;
+
+    uint64_t r (0);
+    for (; i != n && s[i] >= '0' && s[i] <= '7'; ++i)
+    {
+      if (r > (UINT64_MAX >> 3))
+        return nullopt;
+
+      r = (r << 3) | static_cast<uint64_t> (s[i] - '0');
+    }
+
+    for (; i != n; ++i)
+    {
+      if (s[i] != ' ' && s[i] != '\0')
+        return nullopt;
+    }
+
+    return r;
+  }
+
+  // Return the NULL-terminated or fixed-length tar header string field.
+  //
+  static inline string
+  tar_string (const char* s, size_t n)
+  {
+    const char* e (static_cast<const char*> (memchr (s, '\0', n)));
+    return string (s, e != nullptr ? static_cast<size_t> (e - s) : n);
+  }
+
+  optional<archive_entries>
+  read_archive (const common_options& co,
+                const path& a,
+                const function<bool (const path&, uint64_t)>& filter)
+  {
+    // Leave the custom setups to tar.
+    //
+    if (co.tar_specified () || !co.tar_option ().empty ())
+      return nullopt;
+
+    const char* d (nullptr);
+    {
+      string e (a.extension ());
+
+      if      (e == "gz")    d = "gzip";
+      else if (e == "bzip2") d = "bzip2";
+      else if (e == "xz")    d = "xz";
+      else if (e != "tar")   return nullopt;
+    }
+
+    process pr (process_exit (0)); // Successfully exited, if not compressed.
+    ifdstream is (ifdstream::badbit);
+
+    // Wait for the decompressor to complete and return true if it succeeded.
+    //
+    auto wait = [&pr, &is] ()
+    {
+      try
+      {
+        is.close (); // Skips the remaining data, if any.
+      }
+      catch (const io_error&) {}
+
+      return pr.wait ();
+    };
+
+    try
+    {
+      if (d != nullptr)
+      {
+        process_path pp (process::try_path_search (d, true));
+
+        if (pp.empty ())
+          return nullopt;
+
+        const char* args[] = {d, "-dc", a.string ().c_str (), nullptr};
+
+        if (verb >= 2)
+          print_process (args);
+
+        // Note that we don't need the decompressor diagnostics since on
+        // failure the caller falls back to tar, which issues it.
+        //
+        auto_fd nfd (open_null ());
+        pr = process (pp, args, 0, -1, nfd.get ());
+
+        is.open (move (pr.in_ofd),
+                 fdstream_mode::skip | fdstream_mode::binary);
+      }
+      else
+        is.open (fdopen (a, fdopen_mode::in | fdopen_mode::binary),
+                 fdstream_mode::binary);
+
+      archive_entries r;
+
+      // Read exactly n bytes or return false.
+      //
+      auto read = [&is] (char* b, size_t n)
+      {
+        is.read (b, n);
+        return static_cast<size_t> (is.gcount ()) == n;
+      };
+
+      // Read the entry data padded to the 512-byte block boundary into the
+      // string, if specified, and skip it otherwise.
+      //
+      // Note that the size comes from the archive, which we don't trust, so
+      // don't reserve more than the reasonable amount upfront and let the
+      // string grow if it is actually that large.
+      //
+      auto read_data = [&read] (uint64_t n, string* s)
+      {
+        if (n > UINT64_MAX - 511)
+          return false;
+
+        uint64_t pn ((n + 511) & ~static_cast<uint64_t> (511));
+        char b[8192];
+
+        if (s != nullptr)
+          s->reserve (static_cast<size_t> (min<uint64_t> (n, 1024 * 1024)));
+
+        for (uint64_t i (0); i != pn; )
+        {
+          size_t k (static_cast<size_t> (min<uint64_t> (pn - i, sizeof (b))));
+
+          if (!read (b, k))
+            return false;
+
+          if (s != nullptr && i < n)
+            s->append (b, static_cast<size_t> (min<uint64_t> (n - i, k)));
+
+          i += k;
+        }
+
+        return true;
+      };
+
+      // The overrides for the next entry specified with the GNU long name
+      // ('L') and pax extended header ('x') entries.
+      //
+      optional<string> next_name;
+      optional<uint64_t> next_size;
+
+      char h[512];
+
+      for (;;)
+      {
+        if (!read (h, sizeof (h)))
+          break; // Premature end of archive.
+
+        // The end of archive is marked with (two) zero blocks.
+        //
+        if (find_if (h, h + sizeof (h), [] (char c) {return c != '\0';}) ==
+            h + sizeof (h))
+        {
+          return wait () ? optional<archive_entries> (move (r)) : nullopt;
+        }
+
+        // Verify the header checksum, for which the checksum field itself
+        // is considered to contain spaces. Note that some historic
+        // implementations use the signed char sum.
+        //
+        optional<uint64_t> cs (tar_octal (h + 148, 8));
+
+        if (!cs)
+          break;
+
+        {
+          uint64_t us (0);
+          int64_t  ss (0);
+
+          for (size_t i (0); i != sizeof (h); ++i)
+          {
+            bool f (i >= 148 && i < 156);
+            us += f ? ' ' : static_cast<unsigned char> (h[i]);
+            ss += f ? ' ' : static_cast<signed char> (h[i]);
+          }
+
+          if (*cs != us && static_cast<int64_t> (*cs) != ss)
+            break;
+        }
+
+        optional<uint64_t> sz (tar_octal (h + 124, 12));
+
+        if (!sz)
+          break;
+
+        char t (h[156]);
+
+        // GNU long name/link name. Note that we don't need the link names.
+        //
+        // Note that the GNU long names and pax headers are kept in memory,
+        // so bail out if any of them is unreasonably large.
+        //
+        if ((t == 'L' || t == 'K' || t == 'x' || t == 'g') &&
+            *sz > 1024 * 1024)
+          break;
+
+        if (t == 'L' || t == 'K')
+        {
+          string s;
+          if (!read_data (*sz, t == 'L' ? &s : nullptr))
+            break;
+
+          if (t == 'L')
+            next_name = tar_string (s.c_str (), s.size ());
+
+          continue;
+        }
+
+        // Pax extended (for the next entry) and global headers. Each record
+        // has the '<length> <keyword>=<value>\n' form.
+        //
+        if (t == 'x' || t == 'g')
+        {
+          string s;
+          if (!read_data (*sz, &s))
+            break;
+
+          if (t == 'g')
+            continue;
+
+          bool bad (false);
+          for (size_t p (0); p != s.size (); )
+          {
+            size_t sp (s.find (' ', p));
+
+            if (sp == string::npos)
+            {
+              bad = true;
+              break;
+            }
+
+            size_t ln (0);
+            for (size_t i (p); i != sp && !bad; ++i)
+            {
+              if (s[i] >= '0' && s[i] <= '9')
+                ln = ln * 10 + static_cast<size_t> (s[i] - '0');
+              else
+                bad = true;
+            }
+
+            if (bad                   ||
+                ln <= sp - p + 1      ||
+                ln > s.size () - p    ||
+                s[p + ln - 1] != '\n')
+            {
+              bad = true;
+              break;
+            }
+
+            string kv (s, sp + 1, p + ln - sp - 2);
+            size_t eq (kv.find ('='));
+
+            if (eq == string::npos)
+            {
+              bad = true;
+              break;
+            }
+
+            string k (kv, 0, eq);
+            string v (kv, eq + 1);
+
+            if (k == "path")
+              next_name = move (v);
+            else if (k == "size")
+            {
+              next_size = 0;
+              for (char c: v)
+              {
+                if (c < '0' || c > '9' || *next_size > (UINT64_MAX - 9) / 10)
+                {
+                  bad = true;
+                  break;
+                }
+
+                *next_size = *next_size * 10 + static_cast<uint64_t> (c - '0');
+              }
+            }
+            else if (k.compare (0, 11, "GNU.sparse.") == 0)
+              bad = true; // Sparse files are not supported.
+
+            if (bad)
+              break;
+
+            p += ln;
+          }
+
+          if (bad)
+            break;
+
+          continue;
+        }
+
+        // Besides the regular files and directories, only list links and
+        // special files. Bail out on anything else (GNU sparse files,
+        // multi-volume archives, etc).
+        //
+        bool reg (t == '0' || t == '\0' || t == '7');
+
+        if (!reg && t != '1' && t != '2' && t != '3' && t != '4' &&
+            t != '5' && t != '6')
+          break;
+
+        string n;
+        if (next_name)
+          n = move (*next_name);
+        else
+        {
+          n = tar_string (h, 100);
+
+          // Prepend the prefix field for the POSIX ustar format (but not for
+          // the old GNU format, which uses this field differently).
+          //
+          if (memcmp (h + 257, "ustar\0", 6) == 0)
+          {
+            string p (tar_string (h + 345, 155));
+
+            if (!p.empty ())
+              n = p + '/' + n;
+          }
+        }
+
+        if (next_size)
+          sz = next_size;
+
+        next_name = nullopt;
+        next_size = nullopt;
+
+        if (n.empty ())
+          break;
+
+        // Note that the links and the special files have no data.
+        //
+        uint64_t ds (reg || t == '5' ? *sz : 0);
+
+        path p (move (n));
+
+        string* s (nullptr);
+        if (reg && filter (p, ds))
+          s = &r.files[p];
+
+        r.contents.push_back (move (p));
+
+        if (!read_data (ds, s))
+          break;
+      }
+
+      // Fall through.
+    }
+    catch (const invalid_path&)
+    {
+      // Fall through.
+    }
+    catch (const io_error&)
+    {
+      // Fall through.
+    }
+    catch (const process_error&)
+    {
+      // Fall through.
+    }
+
+    wait ();
+    return nullopt;
+  }
 }
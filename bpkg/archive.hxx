@@ -4,6 +4,8 @@
 #ifndef BPKG_ARCHIVE_HXX
 #define BPKG_ARCHIVE_HXX
 
+#include <map>
+
 #include <bpkg/types.hxx>
 #include <bpkg/utility.hxx>
 
@@ -18,6 +20,11 @@ namespace bpkg
 
   // Start the process of extracting the archive to the specified directory.
   //
+  // Unless tar decompresses the archive itself (bsdtar on Windows), use the
+  // multi-threaded decompressor, if available: pigz for gzip, lbzip2 for
+  // bzip2, and xz -T0 for xz. Otherwise, a large package archive is
+  // decompressed on a single core.
+  //
   pair<process, process>
   start_extract (const common_options&,
                  const path& archive,
@@ -56,6 +63,33 @@ namespace bpkg
   archive_contents (const common_options&,
                     const path& archive,
                     bool diag = true);
+
+  // Read the archive contents and the selected regular files in a single
+  // pass, parsing the tar format in-process and only running the
+  // decompressor, if required, as a child process.
+  //
+  // The filter function is called for each regular file with its path (as
+  // stored in the archive) and size and should return true if the file
+  // content needs to be read into memory.
+  //
+  // Return nullopt if the archive cannot be read this way, for example,
+  // because the user specified a custom tar program or options, the
+  // decompressor is not found, the archive is broken, or uses a tar format
+  // extension we don't support. In this case the caller is expected to fall
+  // back to the above functions which would also issue the diagnostics, if
+  // required. Note that no diagnostics is issued by this function.
+  //
+  struct archive_entries
+  {
+    paths contents; // As would be returned by archive_contents().
+
+    std::map<path, string> files;
+  };
+
+  optional<archive_entries>
+  read_archive (const common_options&,
+                const path& archive,
+                const function<bool (const path&, uint64_t size)>& filter);
 }
 
 #endif // BPKG_ARCHIVE_HXX
@@ -41,12 +41,16 @@
 #include <bpkg/utility.hxx>
 
 #include <bpkg/diagnostics.hxx>
+#include <bpkg/fetch-cache.hxx>
 #include <bpkg/bpkg-options.hxx>
 
 // Commands.
 //
 #include <bpkg/help.hxx>
 
+#include <bpkg/cache-gc.hxx>
+#include <bpkg/cache-info.hxx>
+
 #include <bpkg/cfg-create.hxx>
 #include <bpkg/cfg-info.hxx>
 #include <bpkg/cfg-link.hxx>
@@ -435,10 +439,12 @@ validate_common_options (const common_options& o, const path* of = nullptr)
   if (o.no_fetch_cache ())
   {
     if (const char* w = (
-          o.offline ()                       ? "--offline"             :
-          o.fetch_cache_specified ()         ? "--fetch-cache"         :
-          o.fetch_cache_path_specified ()    ? "--fetch-cache-path"    :
-          o.fetch_cache_session_specified () ? "--fetch-cache-session" :
+          o.offline ()                        ? "--offline"              :
+          o.fetch_cache_specified ()          ? "--fetch-cache"          :
+          o.fetch_cache_path_specified ()     ? "--fetch-cache-path"     :
+          o.fetch_cache_session_specified ()  ? "--fetch-cache-session"  :
+          o.fetch_cache_max_age_specified ()  ? "--fetch-cache-max-age"  :
+          o.fetch_cache_max_size_specified () ? "--fetch-cache-max-size" :
           nullptr))
     {
       diag_record dr;
@@ -762,6 +768,7 @@ try
 
   exec_dir = path (argv[0]).directory ();
   build2_argv0 = argv[0];
+  cmd_args.assign (argv + 1, argv + argc);
 
   argv_file_scanner argv_scan (argc, argv, "--options-file", false, args_pos);
   group_scanner scan (argv_scan);
@@ -944,6 +951,13 @@ try
     REP_COMMAND (list,   true);
     REP_COMMAND (remove, true);
 
+    // cache-* commands
+    //
+#define CACHE_COMMAND(CMD, TMP) COMMAND_IMPL(cache_, "cache-", CMD, false, TMP)
+
+    CACHE_COMMAND (gc,   false);
+    CACHE_COMMAND (info, false);
+
     assert (false);
     fail << "unhandled command";
   }
@@ -958,6 +972,11 @@ try
   if (build2_sched.started ())
     build2_sched.shutdown ();
 
+  // Print the fetch cache usage statistics, if any.
+  //
+  if (verb >= 3)
+    fetch_cache::print_stats ();
+
   if (!keep_tmp)
   {
     clean_tmp (true /* ignore_error */);
@@ -0,0 +1,46 @@
+// file      : bpkg/cache-gc.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <bpkg/cache-gc.hxx>
+
+#include <bpkg/fetch-cache.hxx>
+#include <bpkg/diagnostics.hxx>
+
+using namespace std;
+
+namespace bpkg
+{
+  int
+  cache_gc (const cache_gc_options& o, cli::scanner& args)
+  {
+    tracer trace ("cache_gc");
+
+    if (args.more ())
+      fail << "unexpected argument '" << args.next () << "'" <<
+        info << "run 'bpkg help cache-gc' for more information";
+
+    fetch_cache cache (o, nullptr /* database */);
+
+    if (!cache.enabled ())
+      fail << "local fetch cache is disabled";
+
+    // Note that the cache entries are removed in parallel (see --jobs for
+    // details).
+    //
+    size_t jobs (parallel_jobs (o));
+
+    l4 ([&]{trace << "collecting garbage using " << jobs << " threads";});
+
+    cache.open (trace);
+
+    fetch_cache::gc_result r (cache.collect_garbage (jobs));
+
+    cache.close ();
+
+    if (verb && !o.no_result ())
+      text << "removed " << r.entries << " cache entries (" << r.size
+           << " bytes)";
+
+    return 0;
+  }
+}
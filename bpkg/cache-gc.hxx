@@ -0,0 +1,18 @@
+// file      : bpkg/cache-gc.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef BPKG_CACHE_GC_HXX
+#define BPKG_CACHE_GC_HXX
+
+#include <bpkg/types.hxx>
+#include <bpkg/utility.hxx>
+
+#include <bpkg/cache-gc-options.hxx>
+
+namespace bpkg
+{
+  int
+  cache_gc (const cache_gc_options&, cli::scanner& args);
+}
+
+#endif // BPKG_CACHE_GC_HXX
@@ -0,0 +1,116 @@
+// file      : bpkg/cache-info.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <bpkg/cache-info.hxx>
+
+#include <iostream> // cout
+
+#include <libbutl/json/serializer.hxx>
+
+#include <bpkg/fetch-cache.hxx>
+#include <bpkg/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace bpkg
+{
+  int
+  cache_info (const cache_info_options& o, cli::scanner& args)
+  {
+    tracer trace ("cache_info");
+
+    if (args.more ())
+      fail << "unexpected argument '" << args.next () << "'" <<
+        info << "run 'bpkg help cache-info' for more information";
+
+    fetch_cache cache (o, nullptr /* database */);
+
+    if (!cache.enabled ())
+      fail << "local fetch cache is disabled";
+
+    cache.open (trace);
+
+    fetch_cache::usage_info u (cache.usage ());
+
+    cache.close ();
+
+    using entry_totals = fetch_cache::entry_totals;
+
+    entry_totals total;
+    for (const entry_totals* et:
+           {&u.metadata, &u.packages, &u.git, &u.sources})
+    {
+      total.entries              += et->entries;
+      total.unknown_size_entries += et->unknown_size_entries;
+      total.size                 += et->size;
+    }
+
+    try
+    {
+      cout.exceptions (ostream::badbit | ostream::failbit);
+
+      switch (o.stdout_format ())
+      {
+      case stdout_format::lines:
+        {
+          auto print = [] (const char* n, const entry_totals& et)
+          {
+            cout << n << ": " << et.entries << ' ' << et.size;
+
+            if (et.unknown_size_entries != 0)
+              cout << ' ' << et.unknown_size_entries;
+
+            cout << '\n';
+          };
+
+          cout << "path: " << u.database.string () << '\n';
+
+          print ("metadata", u.metadata);
+          print ("packages", u.packages);
+          print ("git",      u.git);
+          print ("src",      u.sources);
+          print ("total",    total);
+
+          cout << "trust: " << u.certificates << endl;
+          break;
+        }
+      case stdout_format::json:
+        {
+          json::stream_serializer s (cout);
+
+          auto member = [&s] (const char* n, const entry_totals& et)
+          {
+            s.member_name (n, false /* check */);
+            s.begin_object ();
+            s.member ("entries", et.entries);
+            s.member ("size", et.size);
+            s.member ("unknown_size_entries", et.unknown_size_entries);
+            s.end_object ();
+          };
+
+          s.begin_object ();
+          s.member ("path", u.database.string ());
+
+          member ("metadata", u.metadata);
+          member ("packages", u.packages);
+          member ("git",      u.git);
+          member ("src",      u.sources);
+          member ("total",    total);
+
+          s.member ("trust", u.certificates);
+          s.end_object ();
+
+          cout << endl;
+          break;
+        }
+      }
+    }
+    catch (const io_error&)
+    {
+      fail << "unable to write to stdout";
+    }
+
+    return 0;
+  }
+}
@@ -0,0 +1,18 @@
+// file      : bpkg/cache-info.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef BPKG_CACHE_INFO_HXX
+#define BPKG_CACHE_INFO_HXX
+
+#include <bpkg/types.hxx>
+#include <bpkg/utility.hxx>
+
+#include <bpkg/cache-info-options.hxx>
+
+namespace bpkg
+{
+  int
+  cache_info (const cache_info_options&, cli::scanner& args);
+}
+
+#endif // BPKG_CACHE_INFO_HXX
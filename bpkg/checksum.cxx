@@ -229,76 +229,56 @@ namespace bpkg
   //
   enum class sha256_kind {sha256, sha256sum, shasum};
 
+  // Note that the sums can be calculated concurrently (see --fetch-jobs for
+  // details).
+  //
+  static mutex       mutex_;
   static path        path_;
   static sha256_kind kind_;
 
   static sha256_kind
   check (const common_options& o)
   {
+    mlock l (mutex_);
+
     if (!path_.empty ())
       return kind_; // Cached.
 
-    if (o.sha256_specified ())
-    {
-      const path& p (path_ = o.sha256 ());
+    // The program is only used if specified explicitly (see sha256sum()
+    // for details).
+    //
+    assert (o.sha256_specified ());
 
-      // Figure out which one it is.
-      //
-      const path& n (p.leaf ());
-      const string& s (n.string ());
+    const path& p (path_ = o.sha256 ());
 
-      if (s.find ("sha256sum") != string::npos)
-      {
-        if (!check_sha256sum (p))
-          fail << p << " does not appear to be the 'sha256sum' program";
+    // Figure out which one it is.
+    //
+    const path& n (p.leaf ());
+    const string& s (n.string ());
 
-        kind_ = sha256_kind::sha256sum;
-      }
-      else if (s.find ("shasum") != string::npos)
-      {
-        if (!check_shasum (p))
-          fail << p << " does not appear to be the 'shasum' program";
+    if (s.find ("sha256sum") != string::npos)
+    {
+      if (!check_sha256sum (p))
+        fail << p << " does not appear to be the 'sha256sum' program";
 
-        kind_ = sha256_kind::shasum;
-      }
-      else if (s.find ("sha256") != string::npos)
-      {
-        if (!check_sha256 (p))
-          fail << p << " does not appear to be the 'sha256' program";
+      kind_ = sha256_kind::sha256sum;
+    }
+    else if (s.find ("shasum") != string::npos)
+    {
+      if (!check_shasum (p))
+        fail << p << " does not appear to be the 'shasum' program";
 
-        kind_ = sha256_kind::sha256;
-      }
-      else
-        fail << "unknown sha256 program " << p;
+      kind_ = sha256_kind::shasum;
     }
-    else
+    else if (s.find ("sha256") != string::npos)
     {
-      // See if any is available. The preference order is:
-      //
-      // sha256    (FreeBSD)
-      // sha256sum (Linux coreutils)
-      // shasum    (Perl tool, Mac OS)
-      //
-      if (check_sha256 (path_ = path ("sha256")))
-      {
-        kind_ = sha256_kind::sha256;
-      }
-      else if (check_sha256sum (path_ = path ("sha256sum")))
-      {
-        kind_ = sha256_kind::sha256sum;
-      }
-      else if (check_shasum (path_ = path ("shasum")))
-      {
-        kind_ = sha256_kind::shasum;
-      }
-      else
-        fail << "unable to find 'sha256', 'sha256sum', or 'shasum'" <<
-          info << "use --sha256 to specify the sha256 program location";
+      if (!check_sha256 (p))
+        fail << p << " does not appear to be the 'sha256' program";
 
-      if (verb >= 3)
-        info << "using '" << path_ << "' as the sha256 program, "
-             << "use --sha256 to override";
+      kind_ = sha256_kind::sha256;
     }
+    else
+      fail << "unknown sha256 program " << p;
 
     return kind_;
   }
@@ -336,6 +316,25 @@ namespace bpkg
     if (!exists (f))
       fail << "file " << f << " does not exist";
 
+    // Unless the sha256 program is specified explicitly, calculate the sum
+    // in-process.
+    //
+    if (!o.sha256_specified ())
+    {
+      try
+      {
+        ifdstream is (f, fdopen_mode::binary);
+        sha256 cs (is);
+        is.close ();
+
+        return cs.string ();
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to read from " << f << ": " << e << endf;
+      }
+    }
+
     process pr (start (o, f));
 
     try
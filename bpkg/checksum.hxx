@@ -19,9 +19,10 @@ namespace bpkg
   // The same but for a file. Issue diagnostics and throw failed if anything
   // goes wrong.
   //
-  // Note that unlike the other overloads, this function runs the sha256
-  // program underneath. The reason for this is that the program can be
-  // optimized for the platform.
+  // Note that if the sha256 program is specified explicitly (--sha256), then
+  // this function runs it underneath rather than calculating the sum
+  // in-process. This can be useful if the program is better optimized for
+  // the platform.
   //
   string
   sha256sum (const common_options&, const path& file);
@@ -0,0 +1,118 @@
+// file      : bpkg/fetch-cache-usage-data.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef BPKG_FETCH_CACHE_USAGE_DATA_HXX
+#define BPKG_FETCH_CACHE_USAGE_DATA_HXX
+
+#include <odb/core.hxx>
+
+#include <bpkg/types.hxx>
+#include <bpkg/utility.hxx>
+
+// Must be included last and have no <libbpkg/manifest.hxx> inclusion in front
+// of it (includes it itself; see assert and _version in package-common.hxx
+// for details).
+//
+#include <bpkg/package-common.hxx>
+
+// The fetch cache usage data (entry sizes, etc) is stored in the fetch cache
+// database but belongs to a separate schema (fetch-cache-usage), which is
+// versioned independently of the main fetch cache schema (fetch-cache; see
+// fetch-cache-data.hxx for details). The main schema cannot be migrated
+// without breaking the previous versions of bpkg, which, however, just
+// ignore the objects of this schema.
+//
+// Note that the previous versions of bpkg don't maintain this data and so
+// it must be treated as advisory: the usage data may be missing for some
+// cache entries and may be present for the entries which have already been
+// removed.
+//
+// NOTE: this schema, in turn, should only be changed in the backwards
+//       compatible manner (adding new objects, etc) since the fetch cache
+//       can be used by the different versions of bpkg concurrently (see
+//       fetch_cache::open() for details).
+//
+#define FETCH_CACHE_USAGE_SCHEMA_VERSION_BASE 1
+
+#pragma db model version(FETCH_CACHE_USAGE_SCHEMA_VERSION_BASE, 1, closed)
+
+namespace bpkg
+{
+  // Size of the cache entry filesystem state.
+  //
+  #pragma db object pointer(unique_ptr)
+  class cache_entry_size
+  {
+  public:
+    // The cache entry filesystem entry path relative to the cache directory
+    // in the POSIX representation. For example:
+    //
+    // pkg/metadata/1ecc6299db9ec823
+    // pkg/packages/libfoo-1.2.3.tar.gz
+    // git/1ecc6299db9ec823
+    // src/libfoo-1.2.3
+    //
+    // Note that the shared source directories are always in the src/
+    // subdirectory, regardless of whether the semi-precious cache directory
+    // is used or not.
+    //
+    string entry;
+
+    // Total size of the regular files inside the filesystem entry, in bytes.
+    //
+    uint64_t size;
+
+    // Database mapping.
+    //
+    #pragma db member(entry) id
+  };
+
+  #pragma db view object(cache_entry_size)
+  struct cache_entry_size_total
+  {
+    #pragma db column("coalesce(sum(" + cache_entry_size::size + "), 0)")
+    uint64_t result;
+
+    operator uint64_t () const {return result;}
+  };
+
+  // Cache entries in the least recently accessed first order together with
+  // their sizes, if known.
+  //
+  // Note that when ordered by the access time, SQLite can merge the results
+  // of the individual SELECTs, which use the access time indexes, rather
+  // than sort the combined result. Thus, the cost of iterating over the
+  // first N entries is normally proportional to N rather than to the total
+  // number of entries.
+  //
+  #pragma db view query(                                                \
+    "SELECT entry, access_time, size FROM ("                            \
+    "SELECT 'pkg/metadata/' || directory AS entry, access_time, "       \
+    "(SELECT size FROM cache_entry_size WHERE "                         \
+    "cache_entry_size.entry = 'pkg/metadata/' || directory) AS size "   \
+    "FROM pkg_repository_metadata "                                     \
+    "UNION ALL "                                                        \
+    "SELECT 'pkg/packages/' || archive, access_time, "                  \
+    "(SELECT size FROM cache_entry_size WHERE "                         \
+    "cache_entry_size.entry = 'pkg/packages/' || archive) "             \
+    "FROM pkg_repository_package "                                      \
+    "UNION ALL "                                                        \
+    "SELECT 'git/' || directory, access_time, "                         \
+    "(SELECT size FROM cache_entry_size WHERE "                         \
+    "cache_entry_size.entry = 'git/' || directory) "                    \
+    "FROM git_repository_state "                                        \
+    "UNION ALL "                                                        \
+    "SELECT 'src/' || directory, access_time, "                         \
+    "(SELECT size FROM cache_entry_size WHERE "                         \
+    "cache_entry_size.entry = 'src/' || directory) "                    \
+    "FROM shared_source_directory) "                                    \
+    "(?)")
+  struct cache_entry_lru
+  {
+    string entry;
+    timestamp access_time;
+    optional<uint64_t> size;
+  };
+}
+
+#endif // BPKG_FETCH_CACHE_USAGE_DATA_HXX
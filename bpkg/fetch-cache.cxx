@@ -3,6 +3,8 @@
 
 #include <bpkg/fetch-cache.hxx>
 
+#include <set>
+
 #include <odb/query.hxx>
 #include <odb/result.hxx>
 #include <odb/schema-catalog.hxx>
@@ -10,7 +12,7 @@
 #include <odb/sqlite/database.hxx>
 #include <odb/sqlite/exceptions.hxx>
 
-#include <libbutl/filesystem.hxx> // file_link_count()
+#include <libbutl/filesystem.hxx> // file_link_count(), dir_mtime()
 
 #include <libbuild2/file.hxx> // is_src_root()
 
@@ -21,6 +23,9 @@
 #include <bpkg/fetch-cache-data.hxx>
 #include <bpkg/fetch-cache-data-odb.hxx>
 
+#include <bpkg/fetch-cache-usage-data.hxx>
+#include <bpkg/fetch-cache-usage-data-odb.hxx>
+
 namespace bpkg
 {
   using namespace odb::sqlite;
@@ -103,11 +108,13 @@ namespace bpkg
   // Non-precious.
   //
   static dir_path np_directory_;                      // ~/.cache/build2/
-  static dir_path np_tmp_directory_;                  // ~/.cache/build2/tmp
+  static dir_path np_tmp_directory_;                  // ~/.cache/build2/tmp/<pid>
+  static dir_path lock_directory_;                    // ~/.cache/build2/lock
   static dir_path pkg_repository_directory_;          // ~/.cache/build2/pkg
   static dir_path pkg_repository_metadata_directory_; // ~/.cache/build2/pkg/metadata
   static dir_path pkg_repository_package_directory_;  // ~/.cache/build2/pkg/packages
   static dir_path git_repository_state_directory_;    // ~/.cache/build2/git
+  static dir_path system_package_directory_;          // ~/.cache/build2/sys
 
   // Semi-precious.
   //
@@ -118,7 +125,7 @@ namespace bpkg
   // and sp end up on different filesystems.
   //
   static dir_path sp_directory_;                      // ~/.build2/cache/
-  static dir_path sp_tmp_directory_;                  // ~/.build2/cache/tmp
+  static dir_path sp_tmp_directory_;                  // ~/.build2/cache/tmp/<pid>
   static dir_path shared_source_directory_;           // ~/.build2/cache/src
 
   // If true, then print progress indicators while waiting for cache database
@@ -130,6 +137,10 @@ namespace bpkg
   //
   static sqlite_synchronous sqlite_synchronous_;
 
+  // Usage statistics (see print_stats() for details).
+  //
+  static fetch_cache::statistics stats_;
+
   cache_mode fetch_cache::
   mode (const common_options& co)
   {
@@ -250,6 +261,18 @@ namespace bpkg
     src_ = *m.src;
     trust_ = *m.trust;
 
+    // Garbage collection budget.
+    //
+    // Note that we cap the values at the ones that can still be represented
+    // as a time duration (~100 years) and in bytes, respectively.
+    //
+    max_age_ = chrono::hours (
+      24 * std::min (co.fetch_cache_max_age (), uint64_t (100 * 365)));
+
+    max_size_ = co.fetch_cache_max_size () <= UINT64_MAX / (1024 * 1024)
+                ? co.fetch_cache_max_size () * 1024 * 1024
+                : UINT64_MAX;
+
     // Get specified or calculate default cache directories.
     //
     // Note that we need to calculate sp_directory even if shared src is
@@ -340,7 +363,17 @@ namespace bpkg
 
         git_repository_state_directory_ = (dir_path (np_directory_) /= "git");
 
+        system_package_directory_ = (dir_path (np_directory_) /= "sys");
+
+        lock_directory_ = (dir_path (np_directory_) /= "lock");
+
+        // Note that the temporary directories are per-process, since the
+        // cache can be used by multiple processes concurrently.
+        //
+        dir_path pd (to_string (process::current_id ()));
+
         np_tmp_directory_ = (dir_path (np_directory_) /= "tmp");
+        np_tmp_directory_ /= pd;
 
         // If semi-precious directory is not used (--fetch-cache-path option
         // is specified, etc), then assume the shared source directory
@@ -350,6 +383,7 @@ namespace bpkg
         {
           shared_source_directory_= (dir_path (sp_directory_) /= "src");
           sp_tmp_directory_ = (dir_path (sp_directory_) /= "tmp");
+          sp_tmp_directory_ /= pd;
         }
         else
           shared_source_directory_= (dir_path (np_directory_) /= "src");
@@ -397,6 +431,7 @@ namespace bpkg
   static const path   db_file_name   ("fetch-cache.sqlite3");
   static const path   db_lock_name   ("fetch-cache.lock");
   static const string db_schema_name ("fetch-cache");
+  static const string db_usage_schema_name ("fetch-cache-usage");
 
   // Register the data migration functions.
   //
@@ -411,10 +446,53 @@ namespace bpkg
   db_schema_name);
 #endif
 
+  // Use an SQLite database as a file lock and grab it either shared or
+  // exclusively. The lock is held until the returned database is destroyed.
+  //
+  // Specifically, we set locking_mode to EXCLUSIVE which instructs SQLite not
+  // to release any locks until the connection is closed. Then we force SQLite
+  // to acquire the shared lock by reading the database or the write lock by
+  // starting exclusive transaction. See the locking_mode pragma documentation
+  // for details.
+  //
+  // Throw odb::timeout if the lock is busy and database_exception if
+  // anything else goes wrong.
+  //
+  unique_ptr<odb::sqlite::database> fetch_cache::
+  file_lock (const path& f, bool exclusive)
+  {
+    unique_ptr<connection_factory> cf (new single_connection_factory);
+
+    unique_ptr<odb::sqlite::database> r (
+      new odb::sqlite::database (
+        f.string (),
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+        [] (odb::sqlite::connection& c)
+        {
+          c.execute ("PRAGMA locking_mode = EXCLUSIVE");
+        },
+        "", // Default VFS.
+        move (cf)));
+
+    if (exclusive)
+    {
+      transaction t (r->begin_exclusive ());
+      t.commit ();
+    }
+    else
+    {
+      transaction t (r->begin ());
+      r->execute ("SELECT count(*) FROM sqlite_master");
+      t.commit ();
+    }
+
+    return r;
+  }
+
   // Throw odb::timeout if the lock is busy.
   //
   void fetch_cache::
-  lock ()
+  lock (bool exclusive)
   {
     if (!exists (np_directory_))
       mk_p (np_directory_);
@@ -423,23 +501,7 @@ namespace bpkg
 
     try
     {
-      // Essentially the same code as in open() below.
-      //
-      unique_ptr<connection_factory> cf (new single_connection_factory);
-
-      lock_.reset (
-        new odb::sqlite::database (
-          f.string (),
-          SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
-          [] (odb::sqlite::connection& c)
-          {
-            c.execute ("PRAGMA locking_mode = EXCLUSIVE");
-          },
-          "", // Default VFS.
-          move (cf)));
-
-      transaction t (lock_->begin_exclusive ());
-      t.commit ();
+      lock_ = file_lock (f, exclusive);
     }
     catch (const database_exception& e)
     {
@@ -447,6 +509,243 @@ namespace bpkg
     }
   }
 
+  void fetch_cache::
+  lock_entry (const string& n, const string& e)
+  {
+    auto i (entry_locks_.find (n));
+    if (i != entry_locks_.end ())
+    {
+      i->second.entries.insert (e);
+      return;
+    }
+
+    if (!exists (lock_directory_))
+      mk_p (lock_directory_);
+
+    path f (lock_directory_ / path (n + ".lock"));
+
+    timestamp start (system_clock::now ());
+
+    for (size_t i (0);; ++i) // Lock wait loop.
+    {
+      try
+      {
+        entry_locks_.emplace (
+          n,
+          entry_lock {file_lock (f, true /* exclusive */), {e}});
+
+        if (i != 0)
+          stats_.lock_wait += system_clock::now () - start;
+
+        break;
+      }
+      catch (const odb::timeout&)
+      {
+        // Sleep 100 milliseconds and retry. Issue the first progress
+        // indicator after 200 milliseconds and then every 5 seconds (see
+        // open() for details).
+        //
+        if (progress_ && (i == 2 || (i > 2 && (i - 2) % 50 == 0)))
+          info << "fetch cache entry in " << np_directory_ << " is used by "
+               << "another process, waiting";
+
+        // Note that we keep waiting since the other process can legitimately
+        // hold the lock for a long time (fetching a large git repository,
+        // etc). However, if that takes unusually long, then warn the user
+        // (regardless of the progress indicators), since the other process
+        // could also be stuck or waiting for a lock held by this process.
+        //
+        if (i == 600) // 1 minute.
+          warn << "fetch cache entry lock " << f << " is held by another "
+               << "process for over a minute, still waiting" <<
+            info << "terminate the other process if it is stuck";
+
+        this_thread::sleep_for (chrono::milliseconds (100));
+      }
+      catch (const database_exception& e)
+      {
+        fail << f << ": " << e.message ();
+      }
+    }
+  }
+
+  void fetch_cache::
+  unlock_entry (const string& n, const string& e)
+  {
+    auto i (entry_locks_.find (n));
+    if (i != entry_locks_.end ())
+    {
+      set<string>& es (i->second.entries);
+      es.erase (e);
+
+      if (es.empty ())
+        entry_locks_.erase (i);
+    }
+  }
+
+  unique_ptr<odb::sqlite::database> fetch_cache::
+  try_lock_entry (const string& n)
+  {
+    unique_ptr<odb::sqlite::database> r;
+
+    try
+    {
+      try_mkdir_p (lock_directory_);
+
+      r = file_lock (lock_directory_ / path (n + ".lock"),
+                     true /* exclusive */);
+    }
+    catch (const odb::timeout&) {}
+    catch (const database_exception&) {}
+    catch (const system_error&) {}
+
+    return r;
+  }
+
+  // Entry lock names. Note that the entries are hashed into 256 lock files
+  // per entry kind (see the fetch_cache class documentation for details).
+  //
+  static const string git_lock_name ("git");
+
+  static string
+  entry_lock_name (const char* kind, const string& key)
+  {
+    return string (kind) + '-' + string (xxh64::string (key).data (), 2);
+  }
+
+  static inline string
+  metadata_lock_name (const repository_url& u)
+  {
+    return entry_lock_name ("metadata", u.string ());
+  }
+
+  static inline string
+  package_lock_name (const package_id& id)
+  {
+    return entry_lock_name ("package", id.name.string ());
+  }
+
+  static inline string
+  source_lock_name (const package_id& id)
+  {
+    return entry_lock_name ("source", id.name.string ());
+  }
+
+  // Entry names for the entry lock tracking (see lock_entry() for details).
+  //
+  static inline string
+  package_lock_entry (const package_id& id)
+  {
+    return id.name.string () + '/' + id.version.string ();
+  }
+
+  // Cache entry names (see cache_entry_size::entry for details).
+  //
+  static const string metadata_entry_prefix ("pkg/metadata/");
+  static const string package_entry_prefix  ("pkg/packages/");
+  static const string git_entry_prefix      ("git/");
+  static const string source_entry_prefix   ("src/");
+
+  // Return the filesystem entry path for the specified cache entry name.
+  //
+  static path
+  entry_path (const string& e)
+  {
+    auto suffix = [&e] (const string& p)
+    {
+      return e.compare (0, p.size (), p) == 0
+             ? string (e, p.size ())
+             : string ();
+    };
+
+    string n;
+    if (!(n = suffix (metadata_entry_prefix)).empty ())
+      return pkg_repository_metadata_directory_ / dir_path (move (n));
+    else if (!(n = suffix (package_entry_prefix)).empty ())
+      return pkg_repository_package_directory_ / path (move (n));
+    else if (!(n = suffix (git_entry_prefix)).empty ())
+      return git_repository_state_directory_ / dir_path (move (n));
+    else if (!(n = suffix (source_entry_prefix)).empty ())
+      return shared_source_directory_ / dir_path (move (n));
+
+    assert (false); // Invalid entry name.
+    return path ();
+  }
+
+  // Return the total size of the regular files inside the specified
+  // filesystem entry, recursively. Note that the size is only used by the
+  // garbage collection and for the usage statistics and so we ignore the
+  // errors, returning the size of what we were able to measure.
+  //
+  static uint64_t
+  entry_size (const path& p)
+  {
+    uint64_t r (0);
+
+    try
+    {
+      pair<bool, entry_stat> pe (path_entry (p, false /* follow_symlinks */));
+
+      if (pe.first)
+      {
+        if (pe.second.type == entry_type::regular)
+        {
+          r = pe.second.size;
+        }
+        else if (pe.second.type == entry_type::directory)
+        {
+          dir_path d (path_cast<dir_path> (p));
+
+          for (const dir_entry& de: dir_iterator (d, dir_iterator::no_follow))
+            r += entry_size (d / de.path ());
+        }
+      }
+    }
+    catch (const system_error&) {}
+
+    return r;
+  }
+
+  // Save (insert or update) or erase the cache entry size. Must be called
+  // inside the cache database transaction.
+  //
+  static void
+  save_entry_size (odb::sqlite::database& db, string e, uint64_t s)
+  {
+    cache_entry_size o {move (e), s};
+
+    if (db.find<cache_entry_size> (o.entry) == nullptr)
+      db.persist (o);
+    else
+      db.update (o);
+  }
+
+  static void
+  erase_entry_size (odb::sqlite::database& db, const string& e)
+  {
+    db.erase_query<cache_entry_size> (query<cache_entry_size>::entry == e);
+  }
+
+  // Count the cache entry lookup hit, adding the entry size, if known, or
+  // miss. Must be called inside the cache database transaction.
+  //
+  static void
+  count_hit (odb::sqlite::database& db,
+             fetch_cache::entry_counters& c,
+             const string& e)
+  {
+    ++c.hits;
+
+    if (unique_ptr<cache_entry_size> s = db.find<cache_entry_size> (e))
+      c.hit_size += s->size;
+  }
+
+  static inline void
+  count_miss (fetch_cache::entry_counters& c)
+  {
+    ++c.misses;
+  }
+
   void fetch_cache::
   open (tracer& tr)
   {
@@ -454,6 +753,16 @@ namespace bpkg
 
     tracer trace ("fetch_cache::open");
 
+    // True if we need to grab the file lock exclusively (see below).
+    //
+    bool excl (false);
+
+    // Note that the time spent waiting for the cache database to become
+    // unlocked is accounted for in the usage statistics.
+    //
+    timestamp start (system_clock::now ());
+    bool waited (false);
+
     for (size_t i (0);; ++i) // Lock wait loop.
     {
       path f; // Cache database path.
@@ -475,7 +784,11 @@ namespace bpkg
           // underneath us.
           //
           // Naturally, we also don't need the lock if sp and np are the same
-          // directory.
+          // directory, unless we create the database.
+          //
+          // To allow multiple instances to use the database concurrently, we
+          // grab the lock shared, unless we need to create or move the
+          // database, in which case we start over grabbing it exclusively.
           //
           path sf;
 
@@ -486,7 +799,7 @@ namespace bpkg
             {
               // Grab the file lock and retest.
               //
-              lock ();
+              lock (excl);
 
               if (!exists (f))
               {
@@ -510,6 +823,22 @@ namespace bpkg
             //
             bool sp (cache_src () && !sp_directory_.empty ());
 
+            // Start over with the exclusive lock if we need to create or move
+            // the database.
+            //
+            if (!excl && (sp || !exists (f)))
+            {
+              excl = true;
+              lock_.reset ();
+              continue;
+            }
+
+            // Grab the exclusive lock, if not grabbed yet (sp and np are the
+            // same directory), and retest.
+            //
+            if (excl && lock_ == nullptr)
+              lock (true /* exclusive */);
+
             if (exists (f))
             {
               // Move it if it should be in sp.
@@ -527,13 +856,18 @@ namespace bpkg
                 //
                 // Note that we move it first to prevent the above check from
                 // seeing the database without its write-ahead log. Note also
-                // that there should be no -shm file since we do exclusive
-                // locking.
+                // that nobody else can have the database open while we hold
+                // the exclusive lock and so we can just remove the
+                // shared-memory file, if any.
                 //
                 path rf (f + "-wal");
                 if (exists (rf))
                   mv (rf, sf + "-wal");
 
+                path mf (f + "-shm");
+                if (exists (mf))
+                  rm (mf);
+
                 mv (f, sf);
 
                 f = move (sf);
@@ -569,18 +903,16 @@ namespace bpkg
             SQLITE_OPEN_READWRITE | (create ? SQLITE_OPEN_CREATE : 0),
             [] (odb::sqlite::connection& c)
             {
-              // Lock the database for as long as the connection is active.
-              // First we set locking_mode to EXCLUSIVE which instructs SQLite
-              // not to release any locks until the connection is closed.
-              // Then, after the database object is created, we force SQLite
-              // to acquire the write lock by starting exclusive transaction.
-              // See the locking_mode pragma documentation for details. This
-              // will also fail if the database is inaccessible (e.g., file
-              // does not exist, already used by another process, etc).
+              // Note that we don't lock the database for as long as the
+              // connection is active, letting multiple processes use it
+              // concurrently. Instead, we wait for the concurrent write
+              // transactions to complete, which are expected to be short
+              // (see the fetch_cache class documentation for details).
               //
-              c.execute ("PRAGMA locking_mode = EXCLUSIVE");
+              c.execute ("PRAGMA busy_timeout = 600000"); // 10 minutes.
 
-              // Use the WAL (Write-Ahead Logging) journaling mode and, by
+              // Use the WAL (Write-Ahead Logging) journaling mode, which
+              // allows readers to proceed concurrently with a writer, and, by
               // default, the NORMAL synchronization mode to speed up the
               // transaction commits.
               //
@@ -651,6 +983,25 @@ namespace bpkg
             }
           }
 
+          // Create or migrate the usage data schema, if necessary (see
+          // fetch-cache-usage-data.hxx for details).
+          //
+          // Note that since this schema is only changed in the backwards
+          // compatible manner, we just use it as is if it is newer than
+          // ours.
+          //
+          {
+            const string& un (db_usage_schema_name);
+
+            odb::schema_version sv  (db.schema_version (un));
+            odb::schema_version scv (schema_catalog::current_version (db, un));
+
+            if (sv == 0)
+              schema_catalog::create_schema (db, un, false /* drop */);
+            else if (sv < scv)
+              schema_catalog::migrate (db, scv, un);
+          }
+
           t.commit ();
         }
 
@@ -660,10 +1011,11 @@ namespace bpkg
       catch (odb::timeout&)
       {
         // Note that this handles both waiting on the lock database and the
-        // actual cache database (see above for details). This is the reason
-        // why we use np_directory_ in diagnostics: when trying to grab the
-        // lock database, we don't yet know where the cache database should
-        // be.
+        // actual cache database (see above for details), though the latter
+        // should only happen if a concurrent write transaction takes
+        // unreasonably long to complete. This is the reason why we use
+        // np_directory_ in diagnostics: when trying to grab the lock
+        // database, we don't yet know where the cache database should be.
         //
         db_.reset ();
         lock_.reset ();
@@ -676,6 +1028,7 @@ namespace bpkg
                << " is used by another process, waiting";
 
         this_thread::sleep_for (chrono::milliseconds (100));
+        waited = true;
       }
       catch (const database_exception& e)
       {
@@ -685,8 +1038,11 @@ namespace bpkg
       }
     }
 
-    // Clean up the temporary directories. Note: do it only once we have the
-    // lock.
+    if (waited)
+      stats_.lock_wait += system_clock::now () - start;
+
+    // Clean up the temporary directories. Note that they are only used by
+    // this process and so are left over from some previous failure.
     //
     if (exists (np_tmp_directory_))
       rm_r (np_tmp_directory_, false /* dir_itself */);
@@ -714,6 +1070,9 @@ namespace bpkg
 
     db_.reset ();
     lock_.reset ();
+
+    entry_locks_.clear ();
+    git_states_ = 0;
   }
 
   bool fetch_cache::
@@ -749,124 +1108,145 @@ namespace bpkg
     return enabled_ && trust_;
   }
 
-  void fetch_cache::
-  garbage_collector ()
+  const dir_path& fetch_cache::
+  system_package_directory () const
+  {
+    assert (enabled_);
+
+    return system_package_directory_;
+  }
+
+  optional<uint64_t> fetch_cache::
+  remove_entry (const string& e, timestamp before, bool git)
   {
     auto& db (*db_);
 
-    // Switch to our own tracer.
+    // The overall plan is as follows:
     //
-    tracer trace ("fetch_cache::garbage_collector");
-    auto tg = make_guard ([o = db.tracer (), &db] () {db.tracer (o);});
-    db.tracer (trace);
+    // 1. Find the entry object by its filesystem entry and grab its lock.
+    //    Skip the entry if the object is absent, has been accessed since the
+    //    specified time point, or the lock is busy (the entry is being used
+    //    by some other process). For a shared source directory, also skip it
+    //    if it is still used by some package configurations.
+    //
+    // 2. Remove the filesystem entry.
+    //
+    // 3. Erase the entry object and its size.
+    //
+    // Note that we remove the filesystem entry outside of the database
+    // transactions, so that multiple entries can be removed in parallel
+    // (see garbage_collector() for details). This is safe since we hold the
+    // entry lock. Note also that we erase the entry object last, to make
+    // sure we are still tracking the filesystem entry if its removal fails
+    // for any reason.
+    //
+    unique_ptr<odb::sqlite::database> l; // Entry lock.
+    path p (entry_path (e));
+    uint64_t r (0);                      // Entry size.
 
-    timestamp now (system_clock::now ());
-    timestamp three_months_ago (now - chrono::hours (24 * 90));
+    unique_ptr<pkg_repository_metadata> md;
+    unique_ptr<pkg_repository_package>  pk;
+    unique_ptr<git_repository_state>    gs;
+    unique_ptr<shared_source_directory> sd;
+
+    // Return true if the object is present and has not been accessed since
+    // the specified time point.
+    //
+    auto outdated = [before] (const auto& o)
+    {
+      return o != nullptr && o->access_time < before;
+    };
 
-    try
     {
       transaction t (db);
 
-      auto stop = [this, &t] ()
+      if (e.compare (0,
+                     metadata_entry_prefix.size (),
+                     metadata_entry_prefix) == 0)
       {
-        if (gc_stop_.load (memory_order_consume))
-        {
-          t.commit ();
-          return true;
-        }
-        else
-          return false;
-      };
+        using query = query<pkg_repository_metadata>;
 
-      // Note: do the work in the most likely to be fruitful order.
+        md = db.query_one<pkg_repository_metadata> (
+          query::directory == path_cast<dir_path> (p).leaf ());
 
-      // Remove the package archives which have not been fetched in the last 3
-      // months.
-      //
-      if (stop ()) return;
-      for (pkg_repository_package& o:
-             db.query<pkg_repository_package> (
-               query<pkg_repository_package>::access_time < three_months_ago))
+        if (!outdated (md) ||
+            (l = try_lock_entry (metadata_lock_name (md->url))) == nullptr)
+          return nullopt;
+      }
+      else if (e.compare (0,
+                          package_entry_prefix.size (),
+                          package_entry_prefix) == 0)
       {
-        if (stop ()) return;
+        using query = query<pkg_repository_package>;
 
-        path f (pkg_repository_package_directory_ / o.archive);
+        pk = db.query_one<pkg_repository_package> (
+          query::archive == p.leaf ());
 
-        if (verb >= 3)
-          text << "rm " << f;
-
-        try
-        {
-          try_rmfile (f);
-        }
-        catch (const system_error& e)
-        {
-          if (verb >= 3)
-            warn << "unable to remove file " << f << ": " << e;
+        if (!outdated (pk) ||
+            (l = try_lock_entry (package_lock_name (pk->id))) == nullptr)
+          return nullopt;
+      }
+      else if (e.compare (0,
+                          git_entry_prefix.size (),
+                          git_entry_prefix) == 0)
+      {
+        using query = query<git_repository_state>;
 
-          continue;
-        }
+        if (!git)
+          return nullopt;
 
-        db.erase (o);
+        gs = db.query_one<git_repository_state> (
+          query::directory == path_cast<dir_path> (p).leaf ());
 
-        if (stop ()) return;
+        if (!outdated (gs))
+          return nullopt;
       }
-
-      // Remove the unused shared source directories which have not been
-      // unpacked or checked out in the last 3 months.
-      //
-      if (stop ()) return;
-      for (shared_source_directory& o:
-             db.query<shared_source_directory> (
-               query<shared_source_directory>::access_time < three_months_ago))
+      else
       {
-        // NOTE: recheck after every long operation (filesystem/database
-        //       access).
-        //
-        if (stop ()) return;
+        using query = query<shared_source_directory>;
 
-        dir_path d (shared_source_directory_ / o.directory);
+        sd = db.query_one<shared_source_directory> (
+          query::directory == path_cast<dir_path> (p).leaf ());
 
-        // Skip the entry if the shared source directory is still used by some
-        // package configurations.
-        //
+        if (!outdated (sd) ||
+            (l = try_lock_entry (source_lock_name (sd->id))) == nullptr)
+          return nullopt;
 
-        // Skip the entry if the hard-links count for its src-root.build file
-        // is greater than 1.
+        // Skip the entry if the shared source directory is still used by
+        // some package configurations. First, skip it if the hard-links
+        // count for its src-root.build file is greater than 1.
         //
-        path p (d / o.src_root_file);
+        path f (p / sd->src_root_file);
 
         try
         {
-          if (file_link_count (p) > 1)
-            continue;
+          if (file_link_count (f) > 1)
+            return nullopt;
         }
-        catch (const system_error& e)
+        catch (const system_error& x)
         {
           if (verb >= 3)
-            warn << "unable to retrieve hard link count for " << p << ": " << e;
+            warn << "unable to retrieve hard link count for " << f << ": "
+                 << x;
 
-          continue;
+          return nullopt;
         }
 
         // Remove non-existing configurations from the list of untracked
-        // configurations (i.e., located on other filesystems). Skip the entry
-        // if any configurations remain in the list. If the last configuration
-        // has been removed, then update the access time and skip the entry to
-        // give it another 3 months of lifetime for good measue (configuration
-        // renamed, etc).
+        // configurations (i.e., located on other filesystems). Skip the
+        // entry if any configurations remain in the list. If the last
+        // configuration has been removed, then update the access time and
+        // skip the entry to give it another maximum age period of lifetime
+        // for good measue (configuration renamed, etc).
         //
-        if (stop ()) return;
-        db.load (o, o.untracked_configurations_section);
-        paths& cs (o.untracked_configurations);
+        db.load (*sd, sd->untracked_configurations_section);
+        paths& cs (sd->untracked_configurations);
 
         size_t n (cs.size ());
 
         for (auto i (cs.begin ()); i != cs.end (); )
         {
-          if (stop ()) return;
-
-          const path& p (*i);
+          const path& c (*i);
 
           try
           {
@@ -875,19 +1255,19 @@ namespace bpkg
             // (shared or not). Parsing it to make sure it still refers to
             // this shared source directory feels too hairy at the
             // moment. Let's keep it simple for now and assume that if it
-            // exists, then it still refers to this source directory. The only
-            // drawback is that we may keep a source directory in the cache
-            // longer than necessary.
+            // exists, then it still refers to this source directory. The
+            // only drawback is that we may keep a source directory in the
+            // cache longer than necessary.
             //
-            if (!file_exists (p))
+            if (!file_exists (c))
               i = cs.erase (i);
             else
               ++i;
           }
-          catch (const system_error& e)
+          catch (const system_error& x)
           {
             if (verb >= 3)
-              warn << "unable to stat path " << p << ": " << e;
+              warn << "unable to stat path " << c << ": " << x;
 
             ++i;
           }
@@ -899,127 +1279,339 @@ namespace bpkg
         {
           if (cs.empty ())
           {
-            o.access_time = system_clock::now ();
+            sd->access_time = system_clock::now ();
             force_skip = true;
           }
 
-          db.update (o); // Note: mutually exclusive with erase() below.
+          db.update (*sd);
         }
 
         if (!cs.empty () || force_skip)
-          continue;
+        {
+          t.commit ();
+          return nullopt;
+        }
+      }
 
-        if (stop ()) return;
+      // Get the entry size, measuring it if unknown.
+      //
+      unique_ptr<cache_entry_size> s (db.find<cache_entry_size> (e));
+      r = s != nullptr ? s->size : entry_size (p);
+
+      t.commit ();
+    }
+
+    // Remove the filesystem entry.
+    //
+    try
+    {
+      if (pk != nullptr)
+      {
+        if (verb >= 3)
+          text << "rm " << p;
+
+        try_rmfile (p);
+      }
+      else
+      {
+        dir_path d (path_cast<dir_path> (p));
 
-        // Remove the shared source directory and the database entry.
-        //
         if (verb >= 3)
           text << "rm -r " << d;
 
-        try
+        if (dir_exists (d))
+          rmdir_r (d, true /* dir */);
+      }
+    }
+    catch (const system_error& x)
+    {
+      if (verb >= 3)
+        warn << "unable to remove " << p << ": " << x;
+
+      return nullopt;
+    }
+
+    // Erase the entry object and its size.
+    //
+    {
+      transaction t (db);
+
+      if (md != nullptr)
+      {
+        if (db.find<pkg_repository_metadata> (md->url) != nullptr)
+          db.erase (*md);
+      }
+      else if (pk != nullptr)
+      {
+        if (db.find<pkg_repository_package> (pk->id) != nullptr)
+          db.erase (*pk);
+      }
+      else if (gs != nullptr)
+      {
+        if (db.find<git_repository_state> (gs->url) != nullptr)
+          db.erase (*gs);
+      }
+      else
+      {
+        if (db.find<shared_source_directory> (sd->id) != nullptr)
+          db.erase (*sd);
+      }
+
+      erase_entry_size (db, e);
+
+      t.commit ();
+    }
+
+    return r;
+  }
+
+  void fetch_cache::
+  garbage_collector (size_t jobs)
+  {
+    auto& db (*db_);
+
+    // Switch to our own tracer.
+    //
+    tracer trace ("fetch_cache::garbage_collector");
+    auto tg = make_guard ([o = db.tracer (), &db] () {db.tracer (o);});
+    db.tracer (trace);
+
+    timestamp now (system_clock::now ());
+    timestamp outdated (now - max_age_);
+
+    auto stop = [this] ()
+    {
+      return gc_stop_.load (memory_order_consume);
+    };
+
+    // Note that the cache can be used by other processes concurrently. Thus,
+    // we first query the entries to be removed and then remove them one by
+    // one, each in separate transactions, so that we don't keep the database
+    // write-locked for long (see remove_entry() for details).
+    //
+    try
+    {
+      // Note that we skip the git repository states if the git repositories
+      // lock is busy (including by ourselves).
+      //
+      unique_ptr<odb::sqlite::database> gl (try_lock_entry (git_lock_name));
+
+      // Remove the outdated entries and, if the cache exceeds the maximum
+      // size, the least recently used entries until it fits, going through
+      // the entries in the least recently accessed first order.
+      //
+      // Note that some of the entries can be skipped (used by some other
+      // process, etc), in which case we go for another round, excluding
+      // such entries.
+      //
+      // Also note that the entries with unknown sizes (saved by the previous
+      // versions of bpkg, etc; normally, there are none of them) are only
+      // measured when examined, so that the cost stays proportional to the
+      // number of examined entries. Such entries are not accounted for in
+      // the total cache size until then.
+      //
+      std::set<string> skipped;
+
+      for (;;)
+      {
+        if (stop ()) return;
+
+        uint64_t excess (0);
+
+        if (max_size_ != 0)
         {
-          if (dir_exists (d))
-            rmdir_r (d, true /* dir */);
+          transaction t (db);
+
+          uint64_t s (db.query_value<cache_entry_size_total> ());
+
+          if (s > max_size_)
+            excess = s - max_size_;
+
+          t.commit ();
         }
-        catch (const system_error& e)
+
+        // The entries to remove and the time points they must not have been
+        // accessed since.
+        //
+        vector<pair<string, timestamp>> es;
+
+        // The entries measured while being examined.
+        //
+        vector<pair<string, uint64_t>> ms;
         {
-          if (verb >= 3)
-            warn << "unable to remove directory " << d << ": " << e;
+          transaction t (db);
+
+          uint64_t n (0);
+          for (const cache_entry_lru& e:
+                 db.query<cache_entry_lru> ("ORDER BY access_time"))
+          {
+            bool o (e.access_time < outdated);
+
+            if (!o && n >= excess)
+              break;
+
+            if (skipped.find (e.entry) != skipped.end ())
+              continue;
+
+            if (e.size)
+              n += *e.size;
+            else if (excess != 0)
+            {
+              if (stop ()) return;
+
+              uint64_t s (entry_size (entry_path (e.entry)));
+              ms.emplace_back (e.entry, s);
+              n += s;
+            }
+
+            // For the least recently used entry make sure it has not been
+            // accessed since we've queried it.
+            //
+            es.emplace_back (e.entry,
+                             o
+                             ? outdated
+                             : e.access_time + timestamp::duration (1));
+          }
+
+          t.commit ();
+        }
+
+        // Note that the entry could have been removed or measured by some
+        // other process in the meantime.
+        //
+        if (!ms.empty ())
+        {
+          transaction t (db);
+
+          for (pair<string, uint64_t>& m: ms)
+          {
+            if (db.find<cache_entry_size> (m.first) == nullptr)
+              save_entry_size (db, move (m.first), m.second);
+          }
 
-          continue;
+          t.commit ();
         }
 
-        db.erase (o);
+        if (es.empty ())
+          break;
+
+        // Note: not vector<bool> since modified concurrently.
+        //
+        vector<char> removed (es.size (), 0);
+
+        parallel_for (
+          es.size (),
+          jobs,
+          [this, &es, &removed, &gl, &stop] (size_t i)
+          {
+            if (stop ())
+              return;
+
+            const pair<string, timestamp>& e (es[i]);
+
+            if (optional<uint64_t> s = remove_entry (e.first,
+                                                     e.second,
+                                                     gl != nullptr))
+            {
+              removed[i] = 1;
+
+              gc_entries_.fetch_add (1, memory_order_relaxed);
+              gc_size_.fetch_add (*s, memory_order_relaxed);
+            }
+          });
 
         if (stop ()) return;
+
+        size_t rn (0);
+        for (size_t i (0); i != es.size (); ++i)
+        {
+          if (removed[i])
+            ++rn;
+          else
+            skipped.insert (move (es[i].first));
+        }
+
+        // We are done if we have only removed the outdated entries or
+        // couldn't remove anything.
+        //
+        if (excess == 0 || rn == 0)
+          break;
       }
 
-      // Remove the metadata for pkg repositories which have not been fetched
-      // in the last 3 months.
+      // Note that the certificate validity is re-checked regardless if it is
+      // trusted or not (see auth_cert() and auth_real()). Normally, a
+      // certificate is replaced in the repository manifest before it is
+      // expired, eventually is trusted by the user, and ends up in the cache
+      // under the new id.
       //
       if (stop ()) return;
-      for (pkg_repository_metadata& o:
-             db.query<pkg_repository_metadata> (
-               query<pkg_repository_metadata>::access_time < three_months_ago))
       {
-        if (stop ()) return;
-
-        dir_path d (pkg_repository_metadata_directory_ / o.directory);
+        transaction t (db);
 
-        if (verb >= 3)
-          text << "rm -r " << d;
-
-        try
+        for (pkg_repository_auth& o:
+               db.query<pkg_repository_auth> (
+                 query<pkg_repository_auth>::end_date.is_not_null () &&
+                 query<pkg_repository_auth>::end_date < now))
         {
-          if (dir_exists (d))
-            rmdir_r (d, true /* dir */);
-        }
-        catch (const system_error& e)
-        {
-          if (verb >= 3)
-            warn << "unable to remove directory " << d << ": " << e;
+          if (stop ()) break;
 
-          continue;
+          db.erase (o);
         }
 
-        db.erase (o);
-
-        if (stop ()) return;
+        t.commit ();
       }
 
-      // Remove the git repositories which have not been fetched or checked
-      // out in the last 3 months.
+      // Remove the temporary directories left over by the crashed processes
+      // (see open() for details), which have not been modified in the last
+      // week.
       //
       if (stop ()) return;
-      for (git_repository_state& o:
-             db.query<git_repository_state> (
-               query<git_repository_state>::access_time < three_months_ago))
       {
-        if (stop ()) return;
-
-        dir_path d (git_repository_state_directory_ / o.directory);
-
-        if (verb >= 3)
-          text << "rm -r " << d;
+        timestamp week_ago (now - chrono::hours (24 * 7));
 
-        try
-        {
-          if (dir_exists (d))
-            rmdir_r (d, true /* dir */);
-        }
-        catch (const system_error& e)
+        for (const dir_path* td: {&np_tmp_directory_, &sp_tmp_directory_})
         {
-          if (verb >= 3)
-            warn << "unable to remove directory " << d << ": " << e;
+          if (td->empty ())
+            continue;
 
-          continue;
-        }
+          dir_path pd (td->directory ());
 
-        db.erase (o);
+          try
+          {
+            if (!dir_exists (pd))
+              continue;
 
-        if (stop ()) return;
-      }
+            dir_paths ds;
+            for (const dir_entry& de:
+                   dir_iterator (pd, dir_iterator::no_follow))
+            {
+              if (de.ltype () == entry_type::directory)
+              {
+                dir_path d (pd / path_cast<dir_path> (de.path ()));
 
-      // Note that the certificate validity is re-checked regardless if it is
-      // trusted or not (see auth_cert() and auth_real()). Normally, a
-      // certificate is replaced in the repository manifest before it is
-      // expired, eventually is trusted by the user, and ends up in the cache
-      // under the new id.
-      //
-      if (stop ()) return;
-      for (pkg_repository_auth& o:
-             db.query<pkg_repository_auth> (
-               query<pkg_repository_auth>::end_date.is_not_null () &&
-               query<pkg_repository_auth>::end_date < now))
-      {
-        if (stop ()) return;
+                if (d != *td && dir_mtime (d) < week_ago)
+                  ds.push_back (move (d));
+              }
+            }
 
-        db.erase (o);
+            for (const dir_path& d: ds)
+            {
+              if (stop ()) return;
 
-        if (stop ()) return;
-      }
+              if (verb >= 3)
+                text << "rm -r " << d;
 
-      t.commit ();
+              rmdir_r (d, true /* dir */);
+            }
+          }
+          catch (const system_error& e)
+          {
+            if (verb >= 3)
+              warn << "unable to remove temporary directories in " << pd
+                   << ": " << e;
+          }
+        }
+      }
     }
     catch (const database_exception& e)
     {
@@ -1035,7 +1627,12 @@ namespace bpkg
     assert (is_open () && !offline () && !active_gc () && gc_error_.empty ());
 
     gc_stop_.store (false, memory_order_relaxed);
-    gc_thread_ = thread (&fetch_cache::garbage_collector, this);
+    gc_entries_.store (0, memory_order_relaxed);
+    gc_size_.store (0, memory_order_relaxed);
+
+    gc_thread_ = thread (&fetch_cache::garbage_collector,
+                         this,
+                         size_t (1) /* jobs */);
   }
 
   void fetch_cache::
@@ -1053,6 +1650,111 @@ namespace bpkg
     }
   }
 
+  fetch_cache::gc_result fetch_cache::
+  collect_garbage (size_t jobs)
+  {
+    assert (is_open () && !active_gc () && gc_error_.empty ());
+
+    gc_stop_.store (false, memory_order_relaxed);
+    gc_entries_.store (0, memory_order_relaxed);
+    gc_size_.store (0, memory_order_relaxed);
+
+    garbage_collector (jobs);
+
+    if (gc_error_.full ())
+    {
+      gc_error_.flush ();
+      throw failed ();
+    }
+
+    return gc_result {gc_entries_.load (memory_order_relaxed),
+                      gc_size_.load (memory_order_relaxed)};
+  }
+
+  fetch_cache::usage_info fetch_cache::
+  usage ()
+  {
+    assert (is_open () && !active_gc ());
+
+    usage_info r;
+
+    auto& db (*db_);
+
+    r.database = path (db.name ());
+
+    try
+    {
+      transaction t (db);
+
+      for (const cache_entry_lru& e: db.query<cache_entry_lru> ())
+      {
+        auto prefixed = [&e] (const string& p)
+        {
+          return e.entry.compare (0, p.size (), p) == 0;
+        };
+
+        entry_totals& et (prefixed (metadata_entry_prefix) ? r.metadata :
+                          prefixed (package_entry_prefix)  ? r.packages :
+                          prefixed (git_entry_prefix)      ? r.git      :
+                                                             r.sources);
+        ++et.entries;
+
+        if (e.size)
+          et.size += *e.size;
+        else
+          ++et.unknown_size_entries;
+      }
+
+      r.certificates = db.query_value<pkg_repository_auth_count> ();
+
+      t.commit ();
+    }
+    catch (const database_exception& e)
+    {
+      fail << db.name () << ": " << e.message ();
+    }
+
+    return r;
+  }
+
+  const fetch_cache::statistics& fetch_cache::
+  stats ()
+  {
+    return stats_;
+  }
+
+  void fetch_cache::
+  print_stats ()
+  {
+    const statistics& s (stats_);
+
+    auto lookups = [] (const entry_counters& c) {return c.hits + c.misses;};
+
+    if (lookups (s.metadata) == 0 &&
+        lookups (s.packages) == 0 &&
+        lookups (s.git)      == 0 &&
+        lookups (s.sources)  == 0)
+      return;
+
+    diag_record dr (text);
+    dr << "fetch cache statistics:";
+
+    auto print = [&dr] (const char* n, const entry_counters& c)
+    {
+      dr << "\n  " << n << ": " << c.hits << " hits (" << c.hit_size
+         << " bytes), " << c.misses << " misses";
+    };
+
+    print ("metadata", s.metadata);
+    print ("packages", s.packages);
+    print ("git",      s.git);
+    print ("src",      s.sources);
+
+    dr << "\n  lock wait: "
+       << chrono::duration_cast<chrono::milliseconds> (s.lock_wait).count ()
+       << " ms";
+  }
+
   bool fetch_cache::
   load_pkg_repository_auth (const string& id)
   {
@@ -1094,7 +1796,13 @@ namespace bpkg
       pkg_repository_auth a {
         move (id), move (fingerprint), move (name), end_date};
 
-      db.persist (a);
+      // Note that the same certificate could have been saved by another
+      // process in the meantime.
+      //
+      if (db.find<pkg_repository_auth> (a.id) == nullptr)
+        db.persist (a);
+      else
+        db.update (a);
 
       t.commit ();
     }
@@ -1127,6 +1835,8 @@ namespace bpkg
 
     u = canonicalize_url (move (u));
 
+    lock_entry (metadata_lock_name (u), u.string ());
+
     // The overall plan is as follows:
     //
     // 1. See if there is an entry for this URL in the database. If not,
@@ -1168,11 +1878,26 @@ namespace bpkg
             rm_r (d);
 
           db.erase (m);
+          erase_entry_size (db, metadata_entry_prefix + m.directory.string ());
+
+          count_miss (stats_.metadata);
         }
         else
         {
           bool utd (!offline () && m.session != session_); // Up-to-date check.
 
+          // Measure the entry size if unknown (see
+          // save_pkg_repository_metadata() for details).
+          //
+          {
+            string e (metadata_entry_prefix + m.directory.string ());
+
+            if (db.find<cache_entry_size> (e) == nullptr)
+              save_entry_size (db, e, entry_size (d));
+
+            count_hit (db, stats_.metadata, e);
+          }
+
           // Only update the database entry if necessary, to keep the
           // transaction read-only whenever it is possible.
           //
@@ -1204,11 +1929,69 @@ namespace bpkg
           if (update)
             db.update (m);
 
+          path bf (pf + ".bin");
+
+          r = loaded_pkg_repository_metadata {
+            move (rf),
+            utd ? move (m.repositories_checksum) : string (),
+            move (pf),
+            utd ? m.packages_checksum : string (),
+            move (bf),
+            move (m.packages_checksum)};
+        }
+      }
+      else
+        count_miss (stats_.metadata);
+
+      t.commit ();
+    }
+    catch (const database_exception& e)
+    {
+      fail << db.name () << ": " << e.message ();
+    }
+
+    return r;
+  }
+
+  optional<fetch_cache::loaded_pkg_repository_metadata> fetch_cache::
+  peek_pkg_repository_metadata (repository_url u)
+  {
+    assert (is_open () && !active_gc ());
+
+    u = canonicalize_url (move (u));
+
+    optional<loaded_pkg_repository_metadata> r;
+
+    auto& db (*db_);
+
+    try
+    {
+      transaction t (db);
+
+      pkg_repository_metadata m;
+      if (db.find<pkg_repository_metadata> (u, m))
+      {
+        dir_path d (pkg_repository_metadata_directory_ / m.directory);
+
+        path rf (d / m.repositories_path);
+        path pf (d / m.packages_path);
+
+        // Note that load_pkg_repository_metadata() will clean up such an
+        // entry and report it as absent.
+        //
+        if (exists (rf) && exists (pf))
+        {
+          bool utd (!offline () && m.session != session_); // Up-to-date check.
+
+          path bf (pf + ".bin");
+
           r = loaded_pkg_repository_metadata {
             move (rf),
             utd ? move (m.repositories_checksum) : string (),
             move (pf),
-            utd ? move (m.packages_checksum) : string ()};
+            utd ? m.packages_checksum : string (),
+            move (bf),
+            move (m.packages_checksum)};
         }
       }
 
@@ -1231,6 +2014,10 @@ namespace bpkg
 
     u = canonicalize_url (move (u));
 
+    // Normally, already grabbed by load.
+    //
+    lock_entry (metadata_lock_name (u), u.string ());
+
     // The overall plan is as follows:
     //
     // 1. Try to load the current entry from the database:
@@ -1247,6 +2034,7 @@ namespace bpkg
     //
     path rf;
     path pf;
+    path bf;
 
     auto& db (*db_);
 
@@ -1272,7 +2060,20 @@ namespace bpkg
         pf = d / m.packages_path;
         rm (pf);
 
+        // Note that the binary packages manifest file is optional.
+        //
+        bf = pf + ".bin";
+
+        if (exists (bf))
+          rm (bf);
+
         db.update (m);
+
+        // Note that the metadata files are written by the caller after this
+        // function returns and so we just invalidate the entry size, which
+        // will be measured by the next load_pkg_repository_metadata() call.
+        //
+        erase_entry_size (db, metadata_entry_prefix + m.directory.string ());
       }
       else
       {
@@ -1291,6 +2092,7 @@ namespace bpkg
 
         rf = d / repositories_file;
         pf = d / packages_file;
+        bf = pf + ".bin";
 
         pkg_repository_metadata md {
           move (u),
@@ -1303,6 +2105,10 @@ namespace bpkg
           move (packages_checksum)};
 
         db.persist (md);
+
+        // Invalidate the entry size, if any (see above for details).
+        //
+        erase_entry_size (db, metadata_entry_prefix + md.directory.string ());
       }
 
       t.commit ();
@@ -1312,7 +2118,7 @@ namespace bpkg
       fail << db.name () << ": " << e.message ();
     }
 
-    return saved_pkg_repository_metadata {move (rf), move (pf)};
+    return saved_pkg_repository_metadata {move (rf), move (pf), move (bf)};
   }
 
   optional<fetch_cache::loaded_pkg_repository_package> fetch_cache::
@@ -1331,6 +2137,12 @@ namespace bpkg
     // 3. Update entry access_time.
     //
     // 4. Return the archive path and checksum.
+    //
+    // Note that we grab the entry lock first and release it if the archive
+    // is present.
+
+    string ln (package_lock_name (id));
+    lock_entry (ln, package_lock_entry (id));
 
     optional<loaded_pkg_repository_package> r;
 
@@ -1348,9 +2160,16 @@ namespace bpkg
         if (!exists (f))
         {
           db.erase (p);
+          erase_entry_size (db, package_entry_prefix + p.archive.string ());
+
+          count_miss (stats_.packages);
         }
         else
         {
+          count_hit (db,
+                     stats_.packages,
+                     package_entry_prefix + p.archive.string ());
+
           // Only update the database entry if necessary, to keep the
           // transaction read-only whenever it is possible.
           //
@@ -1369,6 +2188,38 @@ namespace bpkg
             move (f), move (p.checksum), move (p.repository)};
         }
       }
+      else
+        count_miss (stats_.packages);
+
+      t.commit ();
+    }
+    catch (const database_exception& e)
+    {
+      fail << db.name () << ": " << e.message ();
+    }
+
+    if (r)
+      unlock_entry (ln, package_lock_entry (id));
+
+    return r;
+  }
+
+  bool fetch_cache::
+  peek_pkg_repository_package (const package_id& id)
+  {
+    assert (is_open () && !active_gc ());
+
+    bool r (false);
+
+    auto& db (*db_);
+
+    try
+    {
+      transaction t (db);
+
+      pkg_repository_package p;
+      if (db.find<pkg_repository_package> (id, p))
+        r = exists (pkg_repository_package_directory_ / p.archive);
 
       t.commit ();
     }
@@ -1398,6 +2249,12 @@ namespace bpkg
     // 2. Move or hard-link/copy the archive to its permanent location.
     //
     // 3. Return the permanent archive path.
+    //
+    // Note that the entry lock is normally already grabbed by load_*() and
+    // is released at the end.
+
+    string ln (package_lock_name (id));
+    lock_entry (ln, package_lock_entry (id));
 
     path an (archive.leaf ());
     path r (pkg_repository_package_directory_ / an);
@@ -1428,6 +2285,12 @@ namespace bpkg
 
       db.persist (p);
 
+      // Note that the archive is not moved into its permanent location yet.
+      //
+      save_entry_size (db,
+                       package_entry_prefix + p.archive.string (),
+                       entry_size (archive));
+
       t.commit ();
     }
     catch (const database_exception& e)
@@ -1452,7 +2315,9 @@ namespace bpkg
       rm.cancel ();
     }
     else
-      hardlink (archive, r);
+      clone_or_hardlink (archive, r);
+
+    unlock_entry (ln, package_lock_entry (id));
 
     return r;
   }
@@ -1518,6 +2383,12 @@ namespace bpkg
     // 6. Return the deduced state and paths to the repository directory and
     //    ls-remote.txt file in the cache temporary directory, regardless of
     //    whether they exist or not.
+    //
+    // Note that we grab the git repositories lock first (see the class
+    // documentation for details).
+
+    lock_entry (git_lock_name, git_lock_name);
+    ++git_states_;
 
     loaded_git_repository_state r;
 
@@ -1547,11 +2418,16 @@ namespace bpkg
             rm_r (sd);
 
           db.erase (s);
+          erase_entry_size (db, git_entry_prefix + s.directory.string ());
 
           r.state = loaded_git_repository_state::absent;
+
+          count_miss (stats_.git);
         }
         else
         {
+          count_hit (db, stats_.git, git_entry_prefix + s.directory.string ());
+
           path lf (sd / ls_remote_file);
 
           // True if ls-remote exists and is up-to-date.
@@ -1613,6 +2489,8 @@ namespace bpkg
           rm_r (sd);
 
         r.state = loaded_git_repository_state::absent;
+
+        count_miss (stats_.git);
       }
 
       t.commit ();
@@ -1652,12 +2530,23 @@ namespace bpkg
     //
     // 2. Move the temporary repository state directory to its permanent
     //    location.
+    //
+    // Note that we release the git repositories lock at the end if no more
+    // loaded states remain.
+
+    assert (git_states_ != 0);
 
     auto& db (*db_);
 
     dir_path sd; // State directory for this repository.
     dir_path td; // Temporary directory for this repository.
 
+    // Measure the repository state size before starting the transaction, not
+    // to keep the database locked while traversing the repository.
+    //
+    uint64_t size (
+      entry_size (np_tmp_directory_ / git_repository_state_name (u)));
+
     try
     {
       transaction t (db);
@@ -1697,6 +2586,8 @@ namespace bpkg
         db.persist (rs);
       }
 
+      save_entry_size (db, git_entry_prefix + sd.leaf ().string (), size);
+
       t.commit ();
     }
     catch (const database_exception& e)
@@ -1708,6 +2599,9 @@ namespace bpkg
       mk_p (git_repository_state_directory_);
 
     mv (td, sd);
+
+    if (--git_states_ == 0)
+      unlock_entry (git_lock_name, git_lock_name);
   }
 
   // Note that this function is not static to make sure that the global
@@ -1761,12 +2655,19 @@ namespace bpkg
         if (!exists (d))
         {
           db.erase (sd);
+          erase_entry_size (db, source_entry_prefix + sd.directory.string ());
 
           r = loaded_shared_source_directory_state {
             false /* present */, tmp_dir / sd.directory};
+
+          count_miss (stats_.sources);
         }
         else
         {
+          count_hit (db,
+                     stats_.sources,
+                     source_entry_prefix + sd.directory.string ());
+
           // Only update the database entry if necessary, to keep the
           // transaction read-only whenever it is possible.
           //
@@ -1791,6 +2692,8 @@ namespace bpkg
         r = loaded_shared_source_directory_state {
           false /* present */,
           tmp_dir / dir_path (id.name.string () + '-' + v.string ())};
+
+        count_miss (stats_.sources);
       }
 
       t.commit ();
@@ -1822,28 +2725,26 @@ namespace bpkg
 
     // The overall plan is as follows:
     //
-    // 1. Create new database entry with current access time. Remove the
-    //    source directory, if exists.
+    // 1. If the entry has been created by another process since the
+    //    load_*() call, then remove the temporary directory and return the
+    //    existing source directory path.
+    //
+    // 2. Otherwise, create new database entry with current access time.
+    //    Remove the source directory, if exists.
+    //
+    // 3. Move the temporary directory to its permanent location.
     //
-    // 2. Move the temporary directory to its permanent location.
+    // 4. Return the permanent source directory path.
     //
-    // 3. Return the permanent source directory path.
+    // Note that we perform the filesystem operations while holding the
+    // database write lock, so that the entry and its directory appear to
+    // other processes at once.
 
     dir_path n (tmp_directory.leaf ());
     assert (n.string () == id.name.string () + '-' + v.string ());
 
     dir_path r (shared_source_directory_ / n);
 
-    // If the shared source directory already exists, probably as a result of
-    // some previous failure, then remove it. Create the database entry last,
-    // to make sure we are not referring to a broken directory if its removal
-    // fails for any reason.
-    //
-    if (exists (r))
-      rm (r);
-    else if (!exists (shared_source_directory_))
-      mk_p (shared_source_directory_);
-
     optional<bool> alt_naming;
 
     try
@@ -1856,12 +2757,41 @@ namespace bpkg
       throw failed (); // Assume the diagnostics has already been issued.
     }
 
+    // Measure the source directory size before starting the transaction, not
+    // to keep the database locked while traversing the directory.
+    //
+    uint64_t size (entry_size (tmp_directory));
+
     auto& db (*db_);
 
     try
     {
       transaction t (db);
 
+      shared_source_directory e;
+      if (db.find<shared_source_directory> (id, e))
+      {
+        dir_path d (shared_source_directory_ / e.directory);
+
+        if (exists (d))
+        {
+          t.commit ();
+
+          rm_r (tmp_directory);
+          return d;
+        }
+
+        db.erase (e);
+      }
+
+      // If the shared source directory already exists, probably as a result
+      // of some previous failure, then remove it.
+      //
+      if (exists (r))
+        rm (r);
+      else if (!exists (shared_source_directory_))
+        mk_p (shared_source_directory_);
+
       assert (alt_naming); // Wouldn't be here otherwise.
 
       shared_source_directory d {
@@ -1875,6 +2805,10 @@ namespace bpkg
 
       db.persist (d);
 
+      save_entry_size (db, source_entry_prefix + d.directory.string (), size);
+
+      mv (tmp_directory, r);
+
       t.commit ();
     }
     catch (const database_exception& e)
@@ -1882,8 +2816,6 @@ namespace bpkg
       fail << db.name () << ": " << e.message ();
     }
 
-    mv (tmp_directory, r);
-
     return r;
   }
 
@@ -1905,6 +2837,12 @@ namespace bpkg
   {
     assert (is_open () && !active_gc ());
 
+    // Note that the entry lock is released by save_*(), unless the entry is
+    // absent.
+    //
+    string ln (source_lock_name (id));
+    lock_entry (ln, package_lock_entry (id));
+
     optional<shared_source_directory_tracking> r;
 
     auto& db (*db_);
@@ -1942,7 +2880,11 @@ namespace bpkg
           r = shared_source_directory_tracking {move (d), hc};
         }
         else
+        {
           db.erase (sd);
+          erase_entry_size (db,
+                            source_entry_prefix + sd.directory.string ());
+        }
       }
 
       t.commit ();
@@ -1952,6 +2894,9 @@ namespace bpkg
       fail << db.name () << ": " << e.message ();
     }
 
+    if (!r)
+      unlock_entry (ln, package_lock_entry (id));
+
     return r;
   }
 
@@ -1969,8 +2914,8 @@ namespace bpkg
     {
       transaction t (db);
 
-      // Note that the cache shouldn't have been unlocked and so this object
-      // should be there.
+      // Note that the entry lock shouldn't have been released and so this
+      // object should be there.
       //
       shared_source_directory sd;
       db.load<shared_source_directory> (id, sd);
@@ -2032,5 +2977,7 @@ namespace bpkg
     {
       fail << db.name () << ": " << e.message ();
     }
+
+    unlock_entry (source_lock_name (id), package_lock_entry (id));
   }
 }
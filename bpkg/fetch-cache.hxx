@@ -4,6 +4,9 @@
 #ifndef BPKG_FETCH_CACHE_HXX
 #define BPKG_FETCH_CACHE_HXX
 
+#include <map>
+#include <set>
+
 #include <odb/sqlite/forward.hxx> // odb::sqlite::database
 
 #include <libbpkg/manifest.hxx>
@@ -20,8 +23,20 @@
 namespace bpkg
 {
   // The local fetch cache is a singleton that is described by a bunch of
-  // static variables (not exposed). The class itself serves as a RAII lock --
-  // while an instance is alive, we have the cache database locked and open.
+  // static variables (not exposed). The class itself serves as a RAII handle
+  // -- while an instance is alive, we have the cache database open.
+  //
+  // The cache can be used by multiple processes concurrently. The cache
+  // database is open in the WAL mode, which allows any number of readers
+  // alongside a single writer, and every load/save_*() function only keeps
+  // the database write-locked for the duration of its (short) transaction.
+  // Consistency of the cache entries (metadata files, etc) between the
+  // load_*() and save_*() calls is guaranteed by the entry locks, which are
+  // grabbed by these functions and only block processes that work on the
+  // same entry (see the individual APIs for details). Note that, to keep the
+  // number of lock files bounded, the entries are hashed into a fixed number
+  // of lock files per entry kind and thus unrelated entries may still
+  // occasionally share a lock.
   //
   // The cache by default is split across two directories: ~/.cache/build2/
   // (or equivalent) for non-precious data (pkg/ and git/ subdirectories
@@ -42,12 +57,17 @@ namespace bpkg
   // created in ~/.cache/build2/ and which is used to protect agains races in
   // this logic (see the fetch_cache::open() implementation for details).
   //
+  // The entry lock files are stored in the ~/.cache/build2/lock/
+  // subdirectory.
+  //
   // The cache data is stored in the following subdirectories:
   //
   // ~/.cache/build2/
   // |
   // |-- pkg/  -- archive repositories metadata and package archives
   // |-- git/  -- git repositories in the fetched state
+  // |-- sys/  -- system package manager query results
+  // |-- lock/ -- entry lock files
   // `-- tmp/  -- temporary directory for intermediate results
   //
   // ~/.build2/cache/
@@ -56,6 +76,9 @@ namespace bpkg
   // |            out (and distributed) from git repositories
   // `-- tmp/  -- temporary directory for intermediate results
   //
+  // Note that each process uses its own subdirectory inside tmp/ (named
+  // after its process id).
+  //
   // The pkg/ subdirectory has the following structure:
   //
   // pkg/
@@ -125,10 +148,12 @@ namespace bpkg
     void
     mode (const common_options&, const database*);
 
-    // Lock and open the fetch cache database.
+    // Open the fetch cache database.
     //
     // Issue diagnotics and throw failed if anything goes wrong. Issue
-    // progress indication if waiting for the cache to become unlocked.
+    // progress indication if waiting for the cache to become unlocked (which
+    // normally only happens when the cache database is being created or
+    // moved by another process).
     //
     void
     open (tracer&);
@@ -141,6 +166,8 @@ namespace bpkg
       return db_ != nullptr;
     }
 
+    // Close the fetch cache database and release all the entry locks.
+    //
     void
     close ();
 
@@ -184,8 +211,32 @@ namespace bpkg
     bool
     cache_trust () const;
 
+    // Return the directory for persistently caching the system package
+    // manager query results (see system_package_query_cache for details).
+    // Should only be called if fetch caching is enabled.
+    //
+    // Note that, unlike other cache data, these results are not tracked in
+    // the cache database and are not garbage-collected (there is only a
+    // small file per system package manager in this directory).
+    //
+    const dir_path&
+    system_package_directory () const;
+
     // Garbage collection.
     //
+    // The garbage collection removes the cache entries which have not been
+    // accessed for longer than the maximum age (--fetch-cache-max-age) and,
+    // if the total cache size exceeds the maximum size
+    // (--fetch-cache-max-size), the least recently accessed entries until
+    // the cache fits into this size. The entries which are being used by
+    // other processes as well as the shared source directories which are
+    // still used by some package configurations are skipped.
+    //
+    // Note that the entry sizes are measured when the entries are saved and
+    // are stored in the cache database. Thus, the cost of the garbage
+    // collection is normally proportional to the number of the removed
+    // entries rather than to the total number of entries.
+    //
   public:
     // Start/stop removal of outdated cache entries. The cache is expected to
     // remain open between the calls to these functions. Note that no
@@ -217,12 +268,97 @@ namespace bpkg
       return gc_thread_.joinable ();
     }
 
+    // Perform the garbage collection synchronously, removing the filesystem
+    // entries using up to the specified number of threads. Issue diagnostics
+    // and throw failed if anything goes wrong. Return the number of removed
+    // entries and their total size in bytes.
+    //
+    // Note that the size of the entries saved by the previous versions of
+    // bpkg is unknown and is measured by this function (and by the
+    // background garbage collection, if the maximum size is specified).
+    //
+    struct gc_result
+    {
+      size_t   entries;
+      uint64_t size;
+    };
+
+    gc_result
+    collect_garbage (size_t jobs);
+
+    // Usage information and statistics.
+    //
+  public:
+    // Cache entry totals. Note that the size of the entries saved by the
+    // previous versions of bpkg may be unknown (see collect_garbage() for
+    // details).
+    //
+    struct entry_totals
+    {
+      size_t   entries = 0;
+      size_t   unknown_size_entries = 0;
+      uint64_t size = 0; // In bytes, excluding entries of unknown size.
+    };
+
+    struct usage_info
+    {
+      path database;
+
+      entry_totals metadata;
+      entry_totals packages;
+      entry_totals git;
+      entry_totals sources;
+
+      size_t certificates = 0; // Trusted repository certificates.
+    };
+
+    usage_info
+    usage ();
+
+    // Cache usage statistics accumulated by all the cache instances in this
+    // process. A lookup is a hit if the cache entry is found and is a miss
+    // otherwise (including when the entry is found to be spoiled). For the
+    // hits, the (known) size of the reused entries is also accumulated.
+    //
+    // Note that a metadata or git repository state hit doesn't necessarily
+    // mean that nothing is fetched, since an up-to-date check may still be
+    // necessary (see load_pkg_repository_metadata() and
+    // load_git_repository_state() for details).
+    //
+    struct entry_counters
+    {
+      size_t   hits = 0;
+      size_t   misses = 0;
+      uint64_t hit_size = 0;
+    };
+
+    struct statistics
+    {
+      entry_counters metadata;
+      entry_counters packages;
+      entry_counters git;
+      entry_counters sources;
+
+      // Time spent waiting for the cache database and entry locks held by
+      // other processes.
+      //
+      timestamp::duration lock_wait = timestamp::duration::zero ();
+    };
+
+    static const statistics&
+    stats ();
+
+    // Print the statistics to stderr, unless no cache lookups have been
+    // performed.
+    //
+    static void
+    print_stats ();
+
     // Trusted (authenticated) pkg repository certificates cache API.
     //
-    // Note that the load_*() and save_*() functions should be called without
-    // unlocking the cache in between (this could easily be relaxed, however,
-    // currently these two functions are called inside the
-    // load/save_pkg_repository_metadata() calls).
+    // Note that the load_*() and save_*() functions don't grab any entry
+    // locks: the worst that can happen is that the same certificate is saved
+    // by multiple processes.
     //
   public:
     bool
@@ -236,8 +372,9 @@ namespace bpkg
 
     // Metadata cache API for pkg repositories.
     //
-    // Note that the load_*() and save_*() functions should be called without
-    // unlocking the cache in between.
+    // Note that the load_*() and save_*() functions grab the repository entry
+    // lock which is held until the cache is closed. Thus, normally, the cache
+    // is closed right after the metadata is written.
     //
   public:
     // Load (find) metadata for the specified pkg repository URL.
@@ -245,6 +382,14 @@ namespace bpkg
     // If returned *_checksum members are not empty, then an up-to-date check
     // is necessary.
     //
+    // The packages_binary_path member points to the packages manifest saved
+    // in the binary form (see pkg_save_packages() for details). Note that
+    // this file may not exist or may be outdated.
+    //
+    // The cached_packages_checksum member is the checksum of the cached
+    // packages manifest file and is always present (see rep_fragment() for
+    // its usage).
+    //
     struct loaded_pkg_repository_metadata
     {
       path   repositories_path;
@@ -252,11 +397,26 @@ namespace bpkg
 
       path   packages_path;
       string packages_checksum;
+
+      path   packages_binary_path;
+
+      string cached_packages_checksum;
     };
 
     optional<loaded_pkg_repository_metadata>
     load_pkg_repository_metadata (repository_url);
 
+    // As above but leave the cache entry intact. Specifically, don't update
+    // the entry session and access time and don't clean up the entry if its
+    // filesystem entries are missing, so that the subsequent
+    // load_pkg_repository_metadata() call returns the same result. Used to
+    // decide ahead of time which metadata needs to be fetched (see
+    // --fetch-jobs for details). Note also that this function doesn't grab
+    // the entry lock.
+    //
+    optional<loaded_pkg_repository_metadata>
+    peek_pkg_repository_metadata (repository_url);
+
     // Save (insert of update) metadata for the specified pkg repository
     // URL. The metadata should be written to the returned paths. Note that
     // the caller is expected to use the "write to temporary and atomically
@@ -266,10 +426,14 @@ namespace bpkg
     // need not be updated. In this case, repositories_path will be empty
     // as well.
     //
+    // The packages manifest can also be optionally saved in the binary form
+    // to the returned packages_binary_path.
+    //
     struct saved_pkg_repository_metadata
     {
       path repositories_path;
       path packages_path;
+      path packages_binary_path;
     };
 
     saved_pkg_repository_metadata
@@ -279,8 +443,10 @@ namespace bpkg
 
     // Package cache API for pkg repositories.
     //
-    // Note that the load_*() and save_*() functions should be called without
-    // unlocking the cache in between.
+    // Note that if the package archive is not cached, then load_*() grabs the
+    // package entry lock which is held until the subsequent save_*() call (or
+    // until the cache is closed). This way concurrent processes don't
+    // download the same archive.
     //
   public:
     // Load (find) package archive for the specified package name and version.
@@ -295,6 +461,14 @@ namespace bpkg
     optional<loaded_pkg_repository_package>
     load_pkg_repository_package (const package_id&);
 
+    // Return true if the package archive for the specified package name and
+    // version is cached. Don't update the entry and don't grab the entry
+    // lock. Used to decide ahead of time which archives need to be fetched
+    // (see --fetch-jobs for details).
+    //
+    bool
+    peek_pkg_repository_package (const package_id&);
+
     // Given the archive path for the specified package name and version, add
     // the cache entry, move or, if the move argument is false, hard-link/copy
     // the archive to its permanent location, and return the permanent archive
@@ -310,8 +484,12 @@ namespace bpkg
 
     // State cache API for git repositories.
     //
-    // Note that the load_*() and save_*() functions should be called without
-    // unlocking the cache in between.
+    // Note that the load_*() function grabs the git repositories lock which
+    // is held until all the loaded repository states are saved (or until the
+    // cache is closed). Since multiple repository states can be loaded at
+    // once (see pkg_checkout() for details), using a single lock for all the
+    // git repositories saves us from deadlocks between processes that load
+    // them in different order.
     //
   public:
     // Load (find) repository state for the specified git repository URL.
@@ -355,7 +533,8 @@ namespace bpkg
     //
     // Also note that it's valid to not call save_*() after the load_*() call,
     // which indicates that the repository state is spoiled. In this case, the
-    // repository temporary directory is removed on the next open() call.
+    // repository temporary directory is removed on the next open() call in
+    // this process or by garbage collection.
     //
     void
     save_git_repository_state (repository_url);
@@ -371,8 +550,12 @@ namespace bpkg
 
     // Shared package source directory cache API.
     //
-    // Note that the load_*() and save_*() functions should be called without
-    // unlocking the cache in between.
+    // Note that the load/save_shared_source_directory() functions don't grab
+    // any entry locks. Instead, if multiple processes end up creating the same
+    // source directory concurrently, then the first saved directory wins and
+    // the rest are discarded. The load/save_*_tracking() functions, however,
+    // grab the package entry lock which is held between these calls (or until
+    // the cache is closed).
     //
   public:
     // If the cache entry is present, then return the permanent source
@@ -448,22 +631,72 @@ namespace bpkg
     bool src_;
     bool trust_;
 
+    // Garbage collection budget (--fetch-cache-max-*). Zero maximum size
+    // means unlimited.
+    //
+    timestamp::duration max_age_;
+    uint64_t            max_size_;
+
     // Database and its lock.
     //
+    static unique_ptr<odb::sqlite::database>
+    file_lock (const path&, bool exclusive);
+
     void
-    lock ();
+    lock (bool exclusive);
 
     unique_ptr<odb::sqlite::database> lock_;
     unique_ptr<odb::sqlite::database> db_;
 
+    // Entry locks.
+    //
+    // Since multiple entries can be hashed into the same lock file, the lock
+    // is tracked for each entry that holds it and the lock file is only
+    // released when the last such entry is unlocked. Locking the entry which
+    // already holds the lock is a noop.
+    //
+    void
+    lock_entry (const string& name, const string& entry);
+
+    void
+    unlock_entry (const string& name, const string& entry);
+
+    // Try to grab the entry lock without waiting and return NULL if the lock
+    // is busy or cannot be grabbed for any other reason. Note that the lock
+    // is not tracked in entry_locks_ and is held until the returned database
+    // is destroyed.
+    //
+    static unique_ptr<odb::sqlite::database>
+    try_lock_entry (const string& name);
+
+    struct entry_lock
+    {
+      unique_ptr<odb::sqlite::database> lock;
+      std::set<string>                  entries; // Entries holding the lock.
+    };
+
+    std::map<string, entry_lock> entry_locks_;
+
+    size_t git_states_ = 0; // Number of loaded but not saved git states.
+
     // Garbage collection.
     //
     void
-    garbage_collector ();
+    garbage_collector (size_t jobs);
+
+    // Remove the cache entry if it has not been accessed since the specified
+    // time point and is not used. Return the size of the removed entry or
+    // nullopt if the entry is skipped. Only remove the git repository state
+    // if the git repositories lock is grabbed by the caller.
+    //
+    optional<uint64_t>
+    remove_entry (const string& entry, timestamp before, bool git);
 
-    thread       gc_thread_;
-    atomic<bool> gc_stop_;
-    diag_record  gc_error_;
+    thread           gc_thread_;
+    atomic<bool>     gc_stop_;
+    diag_record      gc_error_;
+    atomic<size_t>   gc_entries_;
+    atomic<uint64_t> gc_size_;
   };
 }
 
@@ -4,8 +4,9 @@
 #include <bpkg/fetch.hxx>
 
 #include <sstream>
+#include <cstring> // memcpy(), memcmp()
 
-#include <libbutl/filesystem.hxx>      // cpfile ()
+#include <libbutl/filesystem.hxx>      // cpfile(), mvfile(), file_mtime(), etc
 #include <libbutl/manifest-parser.hxx>
 
 #include <bpkg/checksum.hxx>
@@ -310,21 +311,317 @@ namespace bpkg
       auto i (tmp_dirs.find (conf != nullptr ? *conf : empty_dir_path));
       assert (i != tmp_dirs.end ());
 
-      auto_rmfile rmf (i->second / packages_file, !keep_tmp);
-      const path& mf (rmf.path);
+      // Note that packages.manifest can be fetched for multiple repositories
+      // simultaneously (see --fetch-jobs for details). Thus, we fetch it into
+      // the repository URL-specific subdirectory, keeping the file name
+      // (which is shown in the progress indication) intact.
+      //
+      dir_path d (xxh64::string (u.string ()).data ());
+
+      auto_rmdir rmd (i->second / d, !keep_tmp);
+      const dir_path& md (rmd.path);
+
+      if (exists (md))
+        rm_r (md);
+
+      mk (md);
 
-      if (exists (mf))
-        rm (mf);
+      path mf (md / packages_file);
 
       fetch_file (o, u, mf);
       auto r (fetch_manifest<pkg_package_manifests> (&o, mf, iu, u.string ()));
-      rmf.active = true;
+      rmd.active = true;
       return r;
     }
     else
       return fetch_manifest<pkg_package_manifests> (&o, f, iu);
   }
 
+  // The binary packages manifest file format (see pkg_save_packages() for
+  // details):
+  //
+  // <signature> <format-version>
+  // <manifest-file-size> <manifest-file-mtime>
+  // <sha256sum> <package-manifest-count>
+  // {<value-count> {<name> <value>}*}*
+  //
+  // Where the strings are represented as their sizes followed by the data
+  // and the numbers as 64-bit unsigned integers in the native byte order
+  // (the file is never shared between machines). Note that the package
+  // manifest start/end pairs are omitted.
+  //
+  // Increment the format version if changing anything in this format or in
+  // the way the package manifests are constructed from the name/value
+  // pairs.
+  //
+  static const char     packages_binary_signature[] = "bpkg-pms";
+  static const uint64_t packages_binary_version (1);
+
+  // Return the manifest file size and modification time (in nanoseconds
+  // since epoch) or nullopt if the file does not exist.
+  //
+  static optional<pair<uint64_t, uint64_t>>
+  packages_stat (const path& f)
+  {
+    try
+    {
+      pair<bool, entry_stat> pe (path_entry (f, true /* follow_symlinks */));
+
+      if (!pe.first || pe.second.type != entry_type::regular)
+        return nullopt;
+
+      timestamp t (file_mtime (f));
+
+      return make_pair (
+        static_cast<uint64_t> (pe.second.size),
+        static_cast<uint64_t> (t.time_since_epoch ().count ()));
+    }
+    catch (const system_error& e)
+    {
+      fail << "unable to stat " << f << ": " << e << endf;
+    }
+  }
+
+  void
+  pkg_save_packages (const path& mf, const path& bf)
+  {
+    optional<pair<uint64_t, uint64_t>> st (packages_stat (mf));
+
+    if (!st)
+      fail << "file " << mf << " does not exist";
+
+    // Write to the process-specific temporary file and atomically move it
+    // into place, so that a concurrent reader never sees a partially written
+    // file.
+    //
+    auto_rmfile arm (bf + ('.' + to_string (process::current_id ()) + ".tmp"));
+    const path& tf (arm.path);
+
+    try
+    {
+      ofdstream os (tf, fdopen_mode::binary);
+
+      auto write_num = [&os] (uint64_t n)
+      {
+        os.write (reinterpret_cast<const char*> (&n), sizeof (n));
+      };
+
+      auto write_str = [&os, &write_num] (const string& s)
+      {
+        write_num (s.size ());
+        os.write (s.data (), s.size ());
+      };
+
+      os.write (packages_binary_signature, sizeof (packages_binary_signature));
+      write_num (packages_binary_version);
+      write_num (st->first);
+      write_num (st->second);
+
+      // Note that we re-parse the manifest file (which should be valid) to
+      // obtain the name/value pairs rather than serializing the manifest
+      // objects, so that the values are exactly the same as in the file.
+      //
+      ifdstream is (mf);
+      manifest_parser p (is, mf.string ());
+
+      // Header.
+      //
+      manifest_name_value nv (p.next ());
+      string cs;
+      for (nv = p.next (); !nv.empty (); nv = p.next ())
+      {
+        if (nv.name == "sha256sum")
+          cs = move (nv.value);
+      }
+
+      // Package manifests.
+      //
+      vector<vector<manifest_name_value>> ms;
+      for (nv = p.next (); !nv.empty (); nv = p.next ())
+      {
+        vector<manifest_name_value> vs;
+        for (nv = p.next (); !nv.empty (); nv = p.next ())
+          vs.push_back (move (nv));
+
+        ms.push_back (move (vs));
+      }
+
+      is.close ();
+
+      write_str (cs);
+      write_num (ms.size ());
+
+      for (const vector<manifest_name_value>& vs: ms)
+      {
+        write_num (vs.size ());
+
+        for (const manifest_name_value& nv: vs)
+        {
+          write_str (nv.name);
+          write_str (nv.value);
+        }
+      }
+
+      os.close ();
+    }
+    catch (const manifest_parsing& e)
+    {
+      fail (e.name, e.line, e.column) << e.description;
+    }
+    catch (const io_error& e)
+    {
+      fail << "unable to write to " << tf << ": " << e;
+    }
+
+    try
+    {
+      mvfile (tf, bf,
+              cpflags::overwrite_content | cpflags::overwrite_permissions);
+    }
+    catch (const system_error& e)
+    {
+      fail << "unable to move " << tf << " to " << bf << ": " << e;
+    }
+
+    arm.cancel ();
+  }
+
+  optional<pkg_package_manifests>
+  pkg_load_packages (const path& bf, const path& mf, bool iu)
+  {
+    if (!exists (bf))
+      return nullopt;
+
+    vector<char> d;
+
+    try
+    {
+      ifdstream is (bf, fdopen_mode::binary);
+      d = is.read_binary ();
+      is.close ();
+    }
+    catch (const io_error& e)
+    {
+      fail << "unable to read from " << bf << ": " << e;
+    }
+
+    // Note that we treat a truncated or otherwise broken file the same way
+    // as a file in an unknown format.
+    //
+    struct bad_format {};
+
+    size_t i (0);
+
+    auto read_num = [&d, &i] () -> uint64_t
+    {
+      uint64_t r;
+
+      if (d.size () - i < sizeof (r))
+        throw bad_format ();
+
+      memcpy (&r, d.data () + i, sizeof (r));
+      i += sizeof (r);
+      return r;
+    };
+
+    auto read_str = [&d, &i, &read_num] () -> string
+    {
+      uint64_t n (read_num ());
+
+      if (d.size () - i < n)
+        throw bad_format ();
+
+      string r (d.data () + i, n);
+      i += n;
+      return r;
+    };
+
+    try
+    {
+      const size_t n (sizeof (packages_binary_signature));
+
+      if (d.size () < n ||
+          memcmp (d.data (), packages_binary_signature, n) != 0)
+        return nullopt;
+
+      i = n;
+
+      if (read_num () != packages_binary_version)
+        return nullopt;
+
+      // Make sure the binary file corresponds to the manifest file.
+      //
+      uint64_t sz (read_num ());
+      uint64_t mt (read_num ());
+
+      optional<pair<uint64_t, uint64_t>> st (packages_stat (mf));
+
+      if (!st || st->first != sz || st->second != mt)
+        return nullopt;
+
+      pkg_package_manifests r;
+      r.sha256sum = read_str ();
+
+      uint64_t mn (read_num ());
+      r.reserve (mn);
+
+      const string& nm (mf.string ());
+
+      for (uint64_t j (0); j != mn; ++j)
+      {
+        uint64_t vn (read_num ());
+
+        vector<manifest_name_value> vs;
+        vs.reserve (vn);
+
+        for (uint64_t k (0); k != vn; ++k)
+        {
+          manifest_name_value nv;
+          nv.name = read_str ();
+          nv.value = read_str ();
+          vs.push_back (move (nv));
+        }
+
+        // Note that the values are already completed in the packages
+        // manifest file and the location and sha256sum values are present
+        // there (see pkg_package_manifests for details).
+        //
+        package_manifest m (
+          nm,
+          move (vs),
+          iu,
+          false /* complete_values */,
+          package_manifest_flags::forbid_file              |
+          package_manifest_flags::forbid_fragment          |
+          package_manifest_flags::forbid_incomplete_values |
+          package_manifest_flags::require_location         |
+          package_manifest_flags::require_sha256sum);
+
+        if (!m.location || !m.sha256sum)
+          return nullopt;
+
+        r.push_back (move (m));
+      }
+
+      if (i != d.size ())
+        return nullopt;
+
+      return r;
+    }
+    catch (const bad_format&)
+    {
+      return nullopt;
+    }
+    //
+    // Let the caller re-parse the manifest file to issue the proper
+    // diagnostics.
+    //
+    catch (const manifest_parsing&)
+    {
+      return nullopt;
+    }
+  }
+
   signature_manifest
   pkg_fetch_signature (const common_options& o,
                        const repository_location& rl,
@@ -799,12 +799,20 @@ namespace bpkg
   //
   enum class fetch_kind {curl, wget, fetch};
 
+  // Note that the files can be fetched concurrently (see --fetch-jobs for
+  // details). Also note that this mutex also protects the program version
+  // variables (wget_major, curl_version, etc) which are only assigned by
+  // the check_*() functions called from here.
+  //
+  static mutex      mutex_;
   static path       path_;
   static fetch_kind kind_;
 
   static fetch_kind
   check (const common_options& o)
   {
+    mlock l (mutex_);
+
     if (!path_.empty ())
       return kind_; // Cached.
 
@@ -50,6 +50,24 @@ namespace bpkg
                       const repository_location&,
                       bool ignore_unknown);
 
+  // Save the packages manifest file, which is assumed to be valid, in the
+  // binary form which is faster to load. Issue diagnostics and throw failed
+  // if anything goes wrong.
+  //
+  void
+  pkg_save_packages (const path& manifest, const path& binary);
+
+  // Load the packages manifest saved in the binary form by the above
+  // function. Return nullopt if the binary file doesn't exist, is in an
+  // unknown format (for example, saved by a different bpkg version), or
+  // doesn't correspond to the manifest file (its size and modification time
+  // differ).
+  //
+  optional<pkg_package_manifests>
+  pkg_load_packages (const path& binary,
+                     const path& manifest,
+                     bool ignore_unknown);
+
   signature_manifest
   pkg_fetch_signature (const common_options&,
                        const repository_location&,
@@ -70,3 +70,11 @@ $odb "${inc[@]}"                                                      \
     --odb-epilogue '#include <bpkg/wrapper-traits.hxx>'               \
     --include-with-brackets --include-prefix bpkg --guard-prefix BPKG \
     fetch-cache-data.hxx
+
+$odb "${inc[@]}"                                                      \
+    --std c++14 -d sqlite --sqlite-version 3.53.0                     \
+    --generate-query --generate-schema                                \
+    --schema-name 'fetch-cache-usage'                                 \
+    --odb-epilogue '#include <bpkg/wrapper-traits.hxx>'               \
+    --include-with-brackets --include-prefix bpkg --guard-prefix BPKG \
+    fetch-cache-usage-data.hxx
@@ -6,6 +6,7 @@
 #include <bpkg/package.hxx>
 #include <bpkg/package-odb.hxx>
 #include <bpkg/database.hxx>
+#include <bpkg/profile.hxx>
 #include <bpkg/rep-mask.hxx>
 #include <bpkg/satisfaction.hxx>
 
@@ -82,6 +83,9 @@ namespace bpkg
                    bool order,
                    bool revision)
   {
+    if (profile != nullptr)
+      ++profile->available_queries;
+
     // Prepare and cache this query since it's executed a lot. Note that we
     // have to cache one per database.
     //
@@ -242,6 +246,127 @@ namespace bpkg
     return pq.execute ();
   }
 
+  available_package_index* available_index (nullptr);
+
+  vector<const available_package_index::entry*> available_package_index::
+  find (database& db,
+        const package_name& name,
+        const optional<version_constraint>& c,
+        bool revision)
+  {
+    auto i (map_.find (package_key (db, name)));
+
+    if (i == map_.end ())
+    {
+      entries es;
+
+      for (shared_ptr<available_package> ap:
+             pointer_result (
+               query_available (db, name, nullopt /* version_constraint */)))
+      {
+        // All repository fragments the package comes from are equally good,
+        // so we pick the first unmasked one.
+        //
+        lazy_shared_ptr<repository_fragment> rf;
+        for (const auto& pl: ap->locations)
+        {
+          if (!rep_masked_fragment (pl.repository_fragment))
+          {
+            rf = pl.repository_fragment;
+            break;
+          }
+        }
+
+        if (compare_version_eq (ap->id.version,
+                                canonical_version (wildcard_version),
+                                false /* revision */,
+                                false /* iteration */))
+          es.stubs.push_back (es.versions.size ());
+
+        es.versions.push_back (entry {move (ap), move (rf)});
+      }
+
+      i = map_.emplace (package_key (db, name), move (es)).first;
+    }
+
+    const entries& es (i->second);
+    const vector<entry>& vs (es.versions);
+
+    // Narrow down the range of versions which satisfy the constraint. Note
+    // that the versions are sorted in the descending order and ignoring the
+    // revision and/or iteration in comparison doesn't break this order.
+    //
+    auto b (vs.begin ());
+    auto e (vs.end ());
+
+    if (c)
+    {
+      assert (c->complete ());
+
+      if (c->max_version)
+      {
+        canonical_version v (*c->max_version);
+        bool rv (revision || c->max_version->revision);
+        bool open (c->max_open);
+
+        b = partition_point (
+          b, e,
+          [&v, rv, revision, open] (const entry& x)
+          {
+            const canonical_version& xv (x.package->id.version);
+
+            return open
+              ? !compare_version_lt (xv, v, rv, revision)
+              : !compare_version_le (xv, v, rv, revision);
+          });
+      }
+
+      if (c->min_version)
+      {
+        canonical_version v (*c->min_version);
+        bool rv (revision || c->min_version->revision);
+        bool open (c->min_open);
+
+        e = partition_point (
+          b, e,
+          [&v, rv, revision, open] (const entry& x)
+          {
+            const canonical_version& xv (x.package->id.version);
+
+            return open
+              ? compare_version_gt (xv, v, rv, revision)
+              : compare_version_ge (xv, v, rv, revision);
+          });
+      }
+    }
+
+    // Note that a stub satisfies any constraint and so we also add the stubs
+    // outside the range, preserving the version order.
+    //
+    vector<const entry*> r;
+    r.reserve ((e - b) + es.stubs.size ());
+
+    size_t bi (b - vs.begin ());
+    size_t ei (e - vs.begin ());
+
+    for (size_t i: es.stubs)
+    {
+      if (i < bi)
+        r.push_back (&vs[i]);
+    }
+
+    for (auto j (b); j != e; ++j)
+      r.push_back (&*j);
+
+    for (size_t i: es.stubs)
+    {
+      if (i >= ei)
+        r.push_back (&vs[i]);
+    }
+
+    return r;
+  }
+
   // Check if the package is available from the specified repository fragment,
   // its prerequisite repositories, or one of their complements, recursively.
   // Return the first repository fragment that contains the package or NULL if
@@ -375,15 +500,36 @@ namespace bpkg
     return find (r, ap, chain, prereq);
   }
 
-  vector<shared_ptr<available_package>>
-  filter (const shared_ptr<repository_fragment>& r,
-          result<available_package>&& apr,
-          bool prereq)
+  // Return the available package pointer for an element of the query result
+  // or of the index lookup result.
+  //
+  static inline shared_ptr<available_package>
+  package_ptr (shared_ptr<available_package>&& p)
+  {
+    return move (p);
+  }
+
+  static inline shared_ptr<available_package>
+  package_ptr (const available_package_index::entry* e)
+  {
+    return e->package;
+  }
+
+  // Implementation of the filter*() functions for the query result
+  // (pointer_result()) and the index lookup result ranges.
+  //
+  template <typename R>
+  static vector<shared_ptr<available_package>>
+  filter_range (const shared_ptr<repository_fragment>& r,
+                R&& apr,
+                bool prereq)
   {
     vector<shared_ptr<available_package>> aps;
 
-    for (shared_ptr<available_package> ap: pointer_result (apr))
+    for (auto&& i: apr)
     {
+      shared_ptr<available_package> ap (package_ptr (move (i)));
+
       if (filter (r, ap, prereq) != nullptr)
         aps.push_back (move (ap));
     }
@@ -391,16 +537,19 @@ namespace bpkg
     return aps;
   }
 
-  pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>
-  filter_one (const shared_ptr<repository_fragment>& r,
-              result<available_package>&& apr,
-              bool prereq)
+  template <typename R>
+  static pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>
+  filter_one_range (const shared_ptr<repository_fragment>& r,
+                    R&& apr,
+                    bool prereq)
   {
     using result = pair<shared_ptr<available_package>,
                         shared_ptr<repository_fragment>>;
 
-    for (shared_ptr<available_package> ap: pointer_result (apr))
+    for (auto&& i: apr)
     {
+      shared_ptr<available_package> ap (package_ptr (move (i)));
+
       if (shared_ptr<repository_fragment> pr = filter (r, ap, prereq))
         return result (move (ap), move (pr));
     }
@@ -408,16 +557,20 @@ namespace bpkg
     return result ();
   }
 
-  vector<pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>>
-  filter (const vector<shared_ptr<repository_fragment>>& rps,
-          odb::result<available_package>&& apr,
-          bool prereq)
+  template <typename R>
+  static vector<pair<shared_ptr<available_package>,
+                     shared_ptr<repository_fragment>>>
+  filter_range (const vector<shared_ptr<repository_fragment>>& rps,
+                R&& apr,
+                bool prereq)
   {
     vector<pair<shared_ptr<available_package>,
                 shared_ptr<repository_fragment>>> aps;
 
-    for (shared_ptr<available_package> ap: pointer_result (apr))
+    for (auto&& i: apr)
     {
+      shared_ptr<available_package> ap (package_ptr (move (i)));
+
       for (const shared_ptr<repository_fragment>& r: rps)
       {
         if (shared_ptr<repository_fragment> rf = filter (r, ap, prereq))
@@ -431,16 +584,19 @@ namespace bpkg
     return aps;
   }
 
-  pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>
-  filter_one (const vector<shared_ptr<repository_fragment>>& rps,
-              odb::result<available_package>&& apr,
-              bool prereq)
+  template <typename R>
+  static pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>
+  filter_one_range (const vector<shared_ptr<repository_fragment>>& rps,
+                    R&& apr,
+                    bool prereq)
   {
     using result = pair<shared_ptr<available_package>,
                         shared_ptr<repository_fragment>>;
 
-    for (shared_ptr<available_package> ap: pointer_result (apr))
+    for (auto&& i: apr)
     {
+      shared_ptr<available_package> ap (package_ptr (move (i)));
+
       for (const shared_ptr<repository_fragment>& r: rps)
       {
         if (shared_ptr<repository_fragment> rf = filter (r, ap, prereq))
@@ -451,6 +607,38 @@ namespace bpkg
     return result ();
   }
 
+  vector<shared_ptr<available_package>>
+  filter (const shared_ptr<repository_fragment>& r,
+          result<available_package>&& apr,
+          bool prereq)
+  {
+    return filter_range (r, pointer_result (move (apr)), prereq);
+  }
+
+  pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>
+  filter_one (const shared_ptr<repository_fragment>& r,
+              result<available_package>&& apr,
+              bool prereq)
+  {
+    return filter_one_range (r, pointer_result (move (apr)), prereq);
+  }
+
+  vector<pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>>
+  filter (const vector<shared_ptr<repository_fragment>>& rps,
+          odb::result<available_package>&& apr,
+          bool prereq)
+  {
+    return filter_range (rps, pointer_result (move (apr)), prereq);
+  }
+
+  pair<shared_ptr<available_package>, shared_ptr<repository_fragment>>
+  filter_one (const vector<shared_ptr<repository_fragment>>& rps,
+              odb::result<available_package>&& apr,
+              bool prereq)
+  {
+    return filter_one_range (rps, pointer_result (move (apr)), prereq);
+  }
+
   // Sort the available package fragments in the package version descending
   // order and suppress duplicate packages and, optionally, older package
   // revisions.
@@ -483,6 +671,18 @@ namespace bpkg
 
     for (database& db: dbs)
     {
+      if (available_index != nullptr)
+      {
+        for (const available_package_index::entry* e:
+               available_index->find (db, name, c))
+        {
+          if (e->fragment != nullptr)
+            r.emplace_back (e->package, e->fragment);
+        }
+
+        continue;
+      }
+
       for (shared_ptr<available_package> ap:
              pointer_result (query_available (db, name, c)))
       {
@@ -533,9 +733,13 @@ namespace bpkg
     for (const auto& dfs: rfs)
     {
       database& db (dfs.first);
-      for (auto& af: filter (dfs.second,
-                             query_available (db, name, c),
-                             prereq))
+      for (auto& af: (available_index != nullptr
+                      ? filter_range (dfs.second,
+                                      available_index->find (db, name, c),
+                                      prereq)
+                      : filter (dfs.second,
+                                query_available (db, name, c),
+                                prereq)))
       {
         r.emplace_back (
           move (af.first),
@@ -566,7 +770,13 @@ namespace bpkg
     vector<shared_ptr<available_package>> r;
 
     database& db (rf.database ());
-    for (auto& ap: filter (rf.load (), query_available (db, name, c), prereq))
+    for (auto& ap: (available_index != nullptr
+                    ? filter_range (rf.load (),
+                                    available_index->find (db, name, c),
+                                    prereq)
+                    : filter (rf.load (),
+                              query_available (db, name, c),
+                              prereq)))
       r.emplace_back (move (ap));
 
     if (r.empty ())
@@ -593,9 +803,13 @@ namespace bpkg
     //
     database& db (rf.database ());
     auto r (
-      filter_one (rf.load (),
-                  query_available (db, name, c, true /* order */, revision),
-                  prereq));
+      available_index != nullptr
+      ? filter_one_range (rf.load (),
+                          available_index->find (db, name, c, revision),
+                          prereq)
+      : filter_one (rf.load (),
+                    query_available (db, name, c, true /* order */, revision),
+                    prereq));
 
     if (r.first == nullptr)
       r.first = find_imaginary_stub (name);
@@ -619,9 +833,13 @@ namespace bpkg
     // version belongs.
     //
     auto r (
-      filter_one (rfs,
-                  query_available (db, name, c, true /* order */, revision),
-                  prereq));
+      available_index != nullptr
+      ? filter_one_range (rfs,
+                          available_index->find (db, name, c, revision),
+                          prereq)
+      : filter_one (rfs,
+                    query_available (db, name, c, true /* order */, revision),
+                    prereq));
 
     if (r.first == nullptr)
       r.first = find_imaginary_stub (name);
@@ -639,10 +857,18 @@ namespace bpkg
   {
     for (database& db: dbs)
     {
+      shared_ptr<repository_fragment> root (
+        db.load<repository_fragment> (""));
+
       auto r (
-        filter_one (db.load<repository_fragment> (""),
-                    query_available (db, name, c, true /* order */, revision),
-                    prereq));
+        available_index != nullptr
+        ? filter_one_range (root,
+                            available_index->find (db, name, c, revision),
+                            prereq)
+        : filter_one (root,
+                      query_available (db, name, c, true /* order */,
+                                       revision),
+                      prereq));
 
       if (r.first != nullptr)
         return make_pair (
@@ -741,6 +967,20 @@ namespace bpkg
 
     for (database& db: all_dbs)
     {
+      if (available_index != nullptr)
+      {
+        for (const available_package_index::entry* e:
+               available_index->find (db,
+                                      name,
+                                      nullopt /* version_constraint */))
+        {
+          if (e->fragment != nullptr)
+            r.emplace_back (e->package, e->fragment);
+        }
+
+        continue;
+      }
+
       for (shared_ptr<available_package> ap:
              pointer_result (
                query_available (db, name, nullopt /* version_constraint */)))
@@ -4,6 +4,8 @@
 #ifndef BPKG_PACKAGE_QUERY_HXX
 #define BPKG_PACKAGE_QUERY_HXX
 
+#include <map>
+
 #include <odb/core.hxx>
 
 #include <bpkg/types.hxx>
@@ -42,6 +44,55 @@ namespace bpkg
                    bool order = true,
                    bool revision = false);
 
+  // In-memory index of the available packages.
+  //
+  // If installed (see available_index below), then the find_available*()
+  // functions (but not query_available()) look up the available packages in
+  // this index rather than querying the database. The index is populated
+  // lazily, loading all the available package versions for a package name
+  // from a database on the first lookup, and keeps them in the version
+  // descending order along with the first unmasked repository fragment each
+  // of them comes from. As a result, the subsequent version constraint
+  // lookups boil down to binary searches.
+  //
+  // Note that the index must only be installed while the available packages
+  // and the repository masks (see rep-mask.hxx) stay unchanged.
+  //
+  class available_package_index
+  {
+  public:
+    struct entry
+    {
+      shared_ptr<available_package> package;
+
+      // The first unmasked repository fragment the package comes from or
+      // NULL if all of them are masked.
+      //
+      lazy_shared_ptr<repository_fragment> fragment;
+    };
+
+    // Return the available packages that optionally satisfy the specified
+    // version constraint in the version descending order. See
+    // query_available() for the constraint and revision semantics.
+    //
+    vector<const entry*>
+    find (database&,
+          const package_name&,
+          const optional<version_constraint>&,
+          bool revision = false);
+
+  private:
+    struct entries
+    {
+      vector<entry>  versions; // In the version descending order.
+      vector<size_t> stubs;    // Positions of stubs in versions.
+    };
+
+    std::map<package_key, entries> map_;
+  };
+
+  extern available_package_index* available_index;
+
   // Only return packages that are in the specified repository fragments, their
   // complements or prerequisites (if prereq is true), recursively. While you
   // could maybe come up with a (barely comprehensible) view/query to achieve
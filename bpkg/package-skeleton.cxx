@@ -25,6 +25,7 @@
 
 #include <bpkg/bpkg.hxx>
 #include <bpkg/package.hxx>
+#include <bpkg/profile.hxx>
 #include <bpkg/database.hxx>
 #include <bpkg/manifest-utility.hxx>
 
@@ -144,10 +145,200 @@ namespace bpkg
   bootstrap (package_skeleton&, const strings&, bool old = false);
 
   strings package_skeleton::global_config_vars;
+  package_skeleton::evaluation_memo* package_skeleton::memo (nullptr);
+
+  // Pool of loaded but otherwise unmodified build system states (see
+  // evaluation_memo for details), in the order they were returned.
+  //
+  struct pooled_context
+  {
+    string                      key;
+    unique_ptr<build2::context> ctx;
+    build2::scope*              rs;
+  };
+
+  static vector<pooled_context> context_pool;
+
+  // Note that each context holds a fully loaded project so let's not keep
+  // too many of them around.
+  //
+  static const size_t context_pool_size (16);
+
+  package_skeleton::evaluation_memo::
+  ~evaluation_memo ()
+  {
+    clear_contexts ();
+  }
+
+  void package_skeleton::evaluation_memo::
+  clear_contexts ()
+  {
+    context_pool.clear ();
+  }
+
+  // The persisted evaluation results file (relative to the configuration
+  // directory) and the maximum number of results it may contain. Note that
+  // the newer results are saved first and so the older ones end up being
+  // dropped.
+  //
+  static const path skeleton_cache_file (
+    dir_path (bpkg_dir) /= "skeleton-cache.txt");
+
+  static const size_t skeleton_cache_size (4096);
+
+  package_skeleton::evaluation_memo::results& package_skeleton::
+  evaluation_memo::config_results (const dir_path& c)
+  {
+    auto i (configs_.find (c));
+    if (i != configs_.end ())
+      return i->second;
+
+    results& r (configs_[c]);
+
+    // Each line has the '<key> true|false' form. Skip the malformed lines
+    // and only warn about the read errors, since the cache is only an
+    // optimization.
+    //
+    path f (c / skeleton_cache_file);
+
+    if (exists (f, true /* ignore_error */))
+    {
+      try
+      {
+        ifdstream is (f);
+
+        for (string l; !eof (getline (is, l)); )
+        {
+          size_t p (l.find (' '));
+          if (p == string::npos)
+            continue;
+
+          string v (l, p + 1);
+          if (v != "true" && v != "false")
+            continue;
+
+          string k (l, 0, p);
+          if (r.enable.emplace (k, v == "true").second)
+            r.loaded.push_back (move (k));
+        }
+
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        warn << "unable to read from " << f << ": " << e;
+      }
+    }
+
+    return r;
+  }
+
+  optional<bool> package_skeleton::evaluation_memo::
+  find_enable (const dir_path& c, const string& k)
+  {
+    const results& r (config_results (c));
+
+    auto i (r.enable.find (k));
+    return i != r.enable.end () ? i->second : optional<bool> ();
+  }
+
+  void package_skeleton::evaluation_memo::
+  add_enable (const dir_path& c, string k, bool v)
+  {
+    results& r (config_results (c));
+
+    auto p (r.enable.emplace (move (k), v));
+    if (p.second)
+      r.added.push_back (p.first->first);
+  }
+
+  void package_skeleton::evaluation_memo::
+  save ()
+  {
+    for (const auto& cr: configs_)
+    {
+      const results& r (cr.second);
+
+      if (r.added.empty ())
+        continue;
+
+      path f (cr.first / skeleton_cache_file);
+
+      try
+      {
+        // Write to temporary and atomically move into place.
+        //
+        auto_rmfile rm (f + ".tmp");
+
+        ofdstream os (rm.path);
+
+        size_t n (0);
+        auto write = [&r, &os, &n] (const string& k)
+        {
+          if (n != skeleton_cache_size)
+          {
+            os << k << (r.enable.find (k)->second ? " true" : " false")
+               << '\n';
+            ++n;
+          }
+        };
+
+        for (const string& k: reverse_iterate (r.added))
+          write (k);
+
+        for (const string& k: r.loaded)
+          write (k);
+
+        os.close ();
+
+        mvfile (rm.path, f,
+                cpflags::overwrite_content | cpflags::overwrite_permissions);
+
+        rm.cancel ();
+      }
+      catch (const io_error& e)
+      {
+        warn << "unable to write to " << f << ": " << e;
+      }
+      catch (const system_error& e)
+      {
+        warn << "unable to move " << f << ".tmp to " << f << ": " << e;
+      }
+    }
+  }
+
+  void package_skeleton::
+  drop_context ()
+  {
+    if (ctx_ != nullptr && memo != nullptr && !ctx_key_.empty ())
+    {
+      auto i (find_if (context_pool.begin (), context_pool.end (),
+                       [this] (const pooled_context& c)
+                       {
+                         return c.key == ctx_key_;
+                       }));
+
+      // Don't keep duplicates.
+      //
+      if (i == context_pool.end ())
+      {
+        if (context_pool.size () == context_pool_size)
+          context_pool.erase (context_pool.begin ());
+
+        context_pool.push_back (
+          pooled_context {move (ctx_key_), move (ctx_), rs_});
+      }
+    }
+
+    ctx_ = nullptr;
+    rs_ = nullptr;
+    ctx_key_.clear ();
+  }
 
   package_skeleton::
   ~package_skeleton ()
   {
+    drop_context ();
   }
 
   package_skeleton::
@@ -174,6 +365,7 @@ namespace bpkg
         develop_ (v.develop_),
         ctx_ (move (v.ctx_)),
         rs_ (v.rs_),
+        ctx_key_ (move (v.ctx_key_)),
         cmd_vars_ (move (v.cmd_vars_)),
         cmd_vars_cache_ (v.cmd_vars_cache_),
         dependent_vars_ (move (v.dependent_vars_)),
@@ -214,8 +406,10 @@ namespace bpkg
       verified_ = v.verified_;
       loaded_old_config_ = v.loaded_old_config_;
       develop_ = v.develop_;
+      drop_context ();
       ctx_ = move (v.ctx_);
       rs_ = v.rs_;
+      ctx_key_ = move (v.ctx_key_);
       cmd_vars_ = move (v.cmd_vars_);
       cmd_vars_cache_ = v.cmd_vars_cache_;
       dependent_vars_ = move (v.dependent_vars_);
@@ -283,8 +477,7 @@ namespace bpkg
   {
     assert (db_ != nullptr); // Cannot be called after collect_config().
 
-    rs_ = nullptr;
-    ctx_ = nullptr; // Free.
+    drop_context (); // Free.
 
     cmd_vars_.clear ();
     cmd_vars_cache_ = false;
@@ -631,7 +824,7 @@ namespace bpkg
       }
 
       verified_ = true; // Managed to load without errors.
-      ctx_ = nullptr;
+      drop_context ();
     }
     catch (const build2::failed&)
     {
@@ -727,7 +920,7 @@ namespace bpkg
                                                 false});
       }
 
-      ctx_ = nullptr; // Free.
+      drop_context (); // Free.
     }
     catch (const build2::failed&)
     {
@@ -780,7 +973,7 @@ namespace bpkg
         load_root (rs);
 
         verified_ = true;
-        ctx_ = nullptr;
+        drop_context ();
       }
 
       scope& rs (
@@ -807,7 +1000,7 @@ namespace bpkg
         r.second = trim (ds.str ());
       }
 
-      ctx_ = nullptr;
+      drop_context ();
       return r;
     }
     catch (const build2::failed&)
@@ -885,10 +1078,25 @@ namespace bpkg
       //
       if (prefer_accept_)
       {
-        ctx_ = nullptr;
+        drop_context ();
         prefer_accept_ = nullopt;
       }
 
+      // See if this clause has already been evaluated in the same state.
+      //
+      string mk (memo != nullptr ? memo_key (cond, indexes) : string ());
+
+      if (!mk.empty ())
+      {
+        if (optional<bool> r = memo->find_enable (db_->config, mk))
+        {
+          ++memo->hits;
+          return *r;
+        }
+
+        ++memo->misses;
+      }
+
       scope& rs (load ());
 
       // Evaluate the enable condition.
@@ -929,7 +1137,12 @@ namespace bpkg
       {
         // Should evaluate to 'true' or 'false'.
         //
-        return build2::convert<bool> (move (v));
+        bool r (build2::convert<bool> (move (v)));
+
+        if (!mk.empty ())
+          memo->add_enable (db_->config, move (mk), r);
+
+        return r;
       }
       catch (const invalid_argument& e)
       {
@@ -1002,7 +1215,7 @@ namespace bpkg
       {
         if (*prefer_accept_ != indexes)
         {
-          ctx_ = nullptr;
+          drop_context ();
           prefer_accept_ = nullopt;
         }
         else
@@ -1020,6 +1233,10 @@ namespace bpkg
 
       scope& rs (load ());
 
+      // Note that we are about to modify the loaded state.
+      //
+      ctx_key_.clear ();
+
       // Collect all the set config.<name>.* variables on the first pass and
       // filter out unchanged on the second.
       //
@@ -1246,7 +1463,7 @@ namespace bpkg
       // Drop the build system state since it needs reloading (some computed
       // values in root.build may depend on the new configuration values).
       //
-      ctx_ = nullptr;
+      drop_context ();
     }
     catch (const build2::failed&)
     {
@@ -1277,7 +1494,7 @@ namespace bpkg
       //
       if (prefer_accept_)
       {
-        ctx_ = nullptr;
+        drop_context ();
         prefer_accept_ = nullopt;
       }
 
@@ -1308,6 +1525,7 @@ namespace bpkg
       //
       strings dvps;
       scope& rs (load (cfgs, &dvps, true /* defaults */));
+      ctx_key_.clear (); // Note: state is modified below.
 
       // Evaluate the prefer clause.
       //
@@ -1549,7 +1767,7 @@ namespace bpkg
         prefer_accept_ = indexes;
       }
       else
-        ctx_ = nullptr;
+        drop_context ();
 
       return r;
     }
@@ -1581,7 +1799,7 @@ namespace bpkg
       //
       if (prefer_accept_)
       {
-        ctx_ = nullptr;
+        drop_context ();
         prefer_accept_ = nullopt;
       }
 
@@ -1601,6 +1819,7 @@ namespace bpkg
       //
       strings dvps;
       scope& rs (load (cfgs, &dvps, false /* defaults */));
+      ctx_key_.clear (); // Note: state is modified below.
 
       // Evaluate the require clause.
       //
@@ -1878,7 +2097,7 @@ namespace bpkg
       // we may have overrides that the clause did not set, so let's drop it
       // for good measure and also to keep things simple).
       //
-      ctx_ = nullptr;
+      drop_context ();
 
       return r;
     }
@@ -2205,7 +2424,7 @@ namespace bpkg
       }
     }
 
-    ctx_ = nullptr; // Free.
+    drop_context (); // Free.
     db_ = nullptr;
 
     return make_pair (move (vars), move (srcs));
@@ -2285,6 +2504,172 @@ namespace bpkg
     }
   }
 
+  static void
+  append_reflect (xxh64& cs, const reflect_variable_values& vs)
+  {
+    cs.append (vs.size ());
+
+    for (const reflect_variable_value& v: vs)
+    {
+      cs.append (static_cast<uint8_t> (v.origin));
+
+      if (v.type)
+        cs.append (*v.type);
+
+      cs.append (serialize_cmdline (v.name, v.value));
+    }
+  }
+
+  string package_skeleton::
+  memo_key (const string& clause, pair<size_t, size_t> indexes) const
+  {
+    // We can only identify the package skeleton contents by the available
+    // package version.
+    //
+    if (available == nullptr)
+      return string ();
+
+    const string& cc (content_checksum ());
+
+    if (cc.empty ())
+      return string ();
+
+    // Note that the old configuration, if not yet loaded, is identified by
+    // the package selected configuration sources, its location, and its
+    // config.build checksum (see evaluation_memo for details). After it is
+    // loaded, it is merged into config_vars_ and we end up with a different
+    // but equally valid key.
+    //
+    xxh64 cs;
+
+    cs.append (db_->config.string ());
+    cs.append (package.name.string ());
+    cs.append (available->version.string ());
+    cs.append (static_cast<uint64_t> (indexes.first));
+    cs.append (static_cast<uint64_t> (indexes.second));
+    cs.append (clause);
+    cs.append (cc);
+
+    cs.append (system);
+    cs.append (disfigure_);
+    cs.append (load_config_flags);
+    cs.append (loaded_old_config_);
+
+    cs.append (src_root_.string ());
+    cs.append (out_root_.string ());
+    cs.append (old_src_root_.string ());
+    cs.append (old_out_root_.string ());
+
+    if (config_srcs_ != nullptr)
+    {
+      cs.append (config_srcs_->size ());
+
+      for (const config_variable& v: *config_srcs_)
+      {
+        cs.append (v.name);
+        cs.append (static_cast<uint8_t> (v.source));
+      }
+    }
+
+    auto append = [&cs] (const strings& vs)
+    {
+      cs.append (vs.size ()); // To distinguish between adjacent lists.
+
+      for (const string& v: vs)
+        cs.append (v);
+    };
+
+    append (global_config_vars);
+    append (config_vars_);
+    append (dependent_vars_);
+    append (dependency_var_prefixes_);
+
+    append_reflect (cs, reflect_);
+    append_reflect (cs, dependency_reflect_);
+
+    return cs.string ();
+  }
+
+  const string& package_skeleton::
+  content_checksum () const
+  {
+    assert (memo != nullptr && available != nullptr);
+
+    string k (db_->config.string ()        + '\n' +
+              package.name.string ()       + '\n' +
+              available->version.string () + '\n' +
+              src_root_.string ()          + '\n' +
+              out_root_.string ()          + '\n' +
+              old_out_root_.string ());
+
+    auto i (memo->checksums.find (k));
+    if (i != memo->checksums.end ())
+      return i->second;
+
+    string r;
+
+    // Note that if the source directory is not specified, then the skeleton
+    // is loaded from the buildfiles created from the available package
+    // *-build values (see bootstrap() for details).
+    //
+    if (!src_root_.empty () || available->bootstrap_build)
+    {
+      xxh64 cs;
+
+      // Let's not assume that the evaluation results are the same for
+      // different bpkg (and thus build2) versions.
+      //
+      cs.append (BPKG_VERSION_STR);
+
+      cs.append (src_root_.empty ()
+                 ? package_buildfiles_checksum (available->bootstrap_build,
+                                                available->root_build,
+                                                available->buildfiles)
+                 : package_buildfiles_checksum (nullopt /* bootstrap_build */,
+                                                nullopt /* root_build */,
+                                                {}      /* buildfiles */,
+                                                src_root_));
+
+      // Besides the package configuration, the configuration (amalgamation)
+      // config.build can affect the loaded state as well.
+      //
+      // Note that if we fail to read any of these files, then we just don't
+      // memoize the evaluation results, leaving it to the build system to
+      // diagnose the error when the skeleton is loaded.
+      //
+      auto append_config = [&cs] (const dir_path& d)
+      {
+        for (const path* f: {&std_config_file, &alt_config_file})
+        {
+          path p (d / *f);
+
+          if (exists (p, true /* ignore_error */))
+          {
+            try
+            {
+              ifdstream is (p);
+              cs.append (is);
+              cs.append ('\0');
+            }
+            catch (const io_error&)
+            {
+              return false;
+            }
+          }
+        }
+
+        return true;
+      };
+
+      if (append_config (db_->config)                              &&
+          (out_root_.empty ()     || append_config (out_root_))     &&
+          (old_out_root_.empty () || append_config (old_out_root_)))
+        r = cs.string ();
+    }
+
+    return memo->checksums.emplace (move (k), move (r)).first->second;
+  }
+
   const strings& package_skeleton::
   merge_cmd_vars (const strings& dependent_vars,
                   const strings& dependency_vars,
@@ -2504,7 +2889,7 @@ namespace bpkg
       if (old_src_root_.empty ())
         verified_ = true; // Managed to load without errors.
 
-      ctx_ = nullptr;
+      drop_context ();
     }
     catch (const build2::failed&)
     {
@@ -2522,7 +2907,7 @@ namespace bpkg
       if (cfgs.empty ())
         return *rs_;
 
-      ctx_ = nullptr;
+      drop_context ();
     }
 
     if (!loaded_old_config_)
@@ -2568,6 +2953,51 @@ namespace bpkg
                         dependency_vars,
                         dependency_vars.empty () /* cache */));
 
+      // If there are no dependency configurations, then see if we can pick
+      // up a pooled state loaded from the same inputs (see evaluation_memo
+      // for details).
+      //
+      // Note that the old configuration is already merged into cmd_vars at
+      // this point.
+      //
+      string key;
+      if (cfgs.empty () && memo != nullptr && available != nullptr)
+      {
+        xxh64 cs;
+
+        cs.append (db_->config.string ());
+        cs.append (package.name.string ());
+        cs.append (available->version.string ());
+        cs.append (src_root_.string ());
+        cs.append (out_root_.string ());
+
+        cs.append (cmd_vars.size ());
+        for (const string& v: cmd_vars)
+          cs.append (v);
+
+        append_reflect (cs, reflect_);
+        append_reflect (cs, dependency_reflect_);
+
+        key = cs.string ();
+
+        auto i (find_if (context_pool.begin (), context_pool.end (),
+                         [&key] (const pooled_context& c)
+                         {
+                           return c.key == key;
+                         }));
+
+        if (i != context_pool.end ())
+        {
+          ctx_ = move (i->ctx);
+          rs_ = i->rs;
+          ctx_key_ = move (key);
+          context_pool.erase (i);
+
+          ++memo->context_hits;
+          return *rs_;
+        }
+      }
+
       auto df = build2::make_diag_frame (
         [this] (const build2::diag_record& dr)
         {
@@ -2698,6 +3128,7 @@ namespace bpkg
                   src_root_);
 
       rs_ = &rs;
+      ctx_key_ = move (key);
       return rs;
     }
     catch (const build2::failed&)
@@ -2755,6 +3186,9 @@ namespace bpkg
             skl.ctx_ == nullptr      &&
             skl.available != nullptr);
 
+    if (profile != nullptr)
+      ++profile->skeleton_bootstraps;
+
     // The overall plan is as follows:
     //
     // 0. Create filesystem state if necessary (could have been created by
@@ -4,6 +4,8 @@
 #ifndef BPKG_PACKAGE_SKELETON_HXX
 #define BPKG_PACKAGE_SKELETON_HXX
 
+#include <map>
+
 #include <libbuild2/forward.hxx>
 
 #include <bpkg/types.hxx>
@@ -102,6 +104,87 @@ namespace bpkg
 
     static strings global_config_vars;
 
+    // Memo of the clause evaluation results.
+    //
+    // During the dependency resolution the package builds are normally
+    // re-collected from scratch many times (see pkg_build() for details) and
+    // the same clauses end up being re-evaluated in the same state, over and
+    // over again. Since each such evaluation requires (re)loading the build
+    // system state, which is expensive, the caller can install this memo for
+    // the duration of the resolution to reuse the earlier evaluation results.
+    //
+    // The results are keyed by the package, its version, the clause position
+    // and text, as well as the skeleton state the evaluation depends on
+    // (configuration variables, reflect values, etc) and the checksum of the
+    // package buildfiles and the configuration files (config.build) the
+    // state is loaded from. Note that the checksums are only calculated once
+    // per memo and thus it must not be installed while the package
+    // configurations can change on disk.
+    //
+    // Since the keys identify the evaluation inputs completely, the enable
+    // clause results are also persisted across runs in the
+    // .bpkg/skeleton-cache.txt file of the respective configuration. The
+    // results are loaded from this file on the first lookup for the
+    // configuration and the new results are saved into it by save().
+    //
+    // While the memo is installed, the skeletons also return their loaded
+    // but otherwise unmodified build system states (contexts) into a pool
+    // rather than discarding them, so that a skeleton of the same package
+    // version loading with the same inputs can pick one up instead of
+    // bootstrapping and loading the project from scratch. The pool is
+    // cleared when the memo is destroyed or clear_contexts() is called.
+    //
+    struct evaluation_memo
+    {
+      optional<bool>
+      find_enable (const dir_path& config, const string& key);
+
+      void
+      add_enable (const dir_path& config, string key, bool result);
+
+      // Save the new results into the configurations' cache files. Issue a
+      // warning but otherwise ignore errors since the cache is only an
+      // optimization.
+      //
+      void
+      save ();
+
+      // Clear the pool of the build system states (see above). Note that
+      // this is also done by the destructor.
+      //
+      void
+      clear_contexts ();
+
+      size_t hits   = 0;
+      size_t misses = 0;
+
+      size_t context_hits = 0;
+
+      // Package buildfiles and configuration files checksums (see
+      // content_checksum() for details).
+      //
+      std::map<string, string> checksums;
+
+      evaluation_memo () = default;
+      ~evaluation_memo ();
+
+    private:
+      struct results
+      {
+        std::map<string, bool> enable;
+
+        strings loaded; // Keys loaded from the cache file in its order.
+        strings added;  // Keys of the new results in the addition order.
+      };
+
+      results&
+      config_results (const dir_path& config);
+
+      std::map<dir_path, results> configs_;
+    };
+
+    static evaluation_memo* memo;
+
     // The following functions should be called in the following sequence
     // (* -- zero or more, ? -- zero or one):
     //
@@ -303,6 +386,26 @@ namespace bpkg
                     const strings& dependency_vars = {},
                     bool cache = false);
 
+    // Return the evaluation memo key for the specified clause or the empty
+    // string if the evaluation result cannot be memoized (see
+    // evaluation_memo for details).
+    //
+    string
+    memo_key (const string& clause, pair<size_t, size_t> indexes) const;
+
+    // Return the checksum of the package buildfiles and the configuration
+    // files the package skeleton is loaded from or the empty string if it
+    // cannot be calculated. Cache the result in the evaluation memo.
+    //
+    const string&
+    content_checksum () const;
+
+    // Drop the build system state, returning it into the context pool if
+    // it is poolable (see evaluation_memo for details).
+    //
+    void
+    drop_context ();
+
     // Implementation details (public for bootstrap()).
     //
   public:
@@ -349,6 +452,12 @@ namespace bpkg
     unique_ptr<build2::context> ctx_;
     build2::scope* rs_ = nullptr;
 
+    // If not empty, then ctx_ is loaded without any dependency
+    // configurations, is not modified since, and can be pooled under this
+    // key (the checksum of the load inputs).
+    //
+    string ctx_key_;
+
     // Storage for merged build2_cmd_vars and config_vars_ and extra overrides
     // (like config.config.disfigure). If cache is true, then the existing
     // content can be reused.
@@ -6,10 +6,13 @@
 
 #include <sstream>
 
+#include <odb/transaction.hxx>
+
 #include <libbutl/manifest-parser.hxx>
 #include <libbutl/manifest-serializer.hxx>
 
 #include <bpkg/database.hxx>
+#include <bpkg/profile.hxx>
 #include <bpkg/checksum.hxx>
 #include <bpkg/rep-mask.hxx>
 #include <bpkg/pkg-verify.hxx>
@@ -1184,6 +1187,9 @@ namespace bpkg
     using query = query<package_dependent>;
     using prep_query = prepared_query<package_dependent>;
 
+    if (profile != nullptr)
+      ++profile->dependent_queries;
+
     struct params
     {
       string name;
@@ -1225,15 +1231,80 @@ namespace bpkg
     return pq.execute ();
   }
 
+  // Reverse dependency index of the selected packages.
+  //
+  // Map the dependent configurations to their dependents, which are in turn
+  // mapped by the dependency package name and configuration UUID. Note that
+  // since all the attached databases share the same transaction, we drop the
+  // whole index when the transaction is finalized.
+  //
+  using dependents_map = std::map<pair<package_name, string>,
+                                  vector<package_dependent>>;
+
+  static std::map<const database*, dependents_map> dependents_index;
+  static odb::transaction* dependents_transaction (nullptr);
+
+  static void
+  drop_dependents_index (unsigned short, void*, unsigned long long)
+  {
+    dependents_index.clear ();
+    dependents_transaction = nullptr;
+  }
+
+  void selected_package::
+  invalidate_dependents (odb::callback_event e, odb::database& db) const
+  {
+    using odb::callback_event;
+
+    if (e == callback_event::post_persist ||
+        e == callback_event::post_update  ||
+        e == callback_event::post_erase)
+      dependents_index.erase (&static_cast<database&> (db));
+  }
+
   vector<package_dependent>
   query_dependents_cache (database& db,
                           const package_name& dep,
                           database& dep_db)
   {
-    vector<package_dependent> r;
-    for (package_dependent& pd: query_dependents (db, dep, dep_db))
-      r.push_back (move (pd));
-    return r;
+    auto i (dependents_index.find (&db));
+
+    if (i == dependents_index.end ())
+    {
+      if (profile != nullptr)
+        ++profile->dependent_queries;
+
+      dependents_map m;
+
+      for (package_dependent_prerequisite& p:
+             db.query<package_dependent_prerequisite> ())
+      {
+        m[make_pair (move (p.prerequisite), move (p.configuration))].
+          push_back (package_dependent {move (p.name),
+                                        move (p.version_constraint),
+                                        p.type});
+      }
+
+      i = dependents_index.emplace (&db, move (m)).first;
+
+      // Drop the index when the transaction is finalized, unless already
+      // arranged.
+      //
+      if (dependents_transaction == nullptr)
+      {
+        odb::transaction& t (odb::transaction::current ());
+
+        dependents_transaction = &t;
+        t.callback_register (&drop_dependents_index,
+                             &dependents_index,
+                             odb::transaction::event_all,
+                             0 /* data */,
+                             &dependents_transaction);
+      }
+    }
+
+    auto j (i->second.find (make_pair (dep, dep_db.uuid.string ())));
+    return j != i->second.end () ? j->second : vector<package_dependent> ();
   }
 
   bool
@@ -9,6 +9,7 @@
 
 #include <odb/core.hxx>
 #include <odb/section.hxx>
+#include <odb/callback.hxx>
 #include <odb/nested-container.hxx>
 
 #include <libbpkg/package-name.hxx>
@@ -33,7 +34,7 @@
 //
 #define DB_SCHEMA_VERSION_BASE 26
 
-#pragma db model version(DB_SCHEMA_VERSION_BASE, 30, closed)
+#pragma db model version(DB_SCHEMA_VERSION_BASE, 31, closed)
 
 namespace bpkg
 {
@@ -220,6 +221,20 @@ namespace bpkg
     dependencies complements;
     dependencies prerequisites;
 
+    // Checksum of the packages metadata this fragment's available packages
+    // have been created from. Absent if unknown, which is currently always
+    // the case for non-pkg repositories. Used to detect that the fragment
+    // is unchanged and so its available packages need not be recreated on
+    // re-fetch (see rep_fragment() for details).
+    //
+    // NOTE: any future migration that changes the available_package object
+    //       (adds a member populated on fetch, changes how an existing
+    //       member is populated, etc) must reset this column to NULL in all
+    //       the repository fragments. Otherwise, the unchanged repositories
+    //       will never be repopulated with the new data.
+    //
+    optional<string> packages_checksum;
+
   public:
     explicit
     repository_fragment (repository_location l)
@@ -1090,7 +1105,8 @@ namespace bpkg
     config_source source;
   };
 
-  #pragma db object pointer(shared_ptr) session
+  #pragma db object pointer(shared_ptr) session \
+    callback(invalidate_dependents)
   class selected_package
   {
   public:
@@ -1381,6 +1397,13 @@ namespace bpkg
       manifest (move (m)),
       has_dependency_constraint (false) {}
 
+    // Invalidate the dependents index of the configuration this package is
+    // persisted/updated/erased in (see query_dependents_cache() for
+    // details).
+    //
+    void
+    invalidate_dependents (odb::callback_event, odb::database&) const;
+
   private:
     friend class odb::access;
     selected_package () = default;
@@ -1610,12 +1633,43 @@ namespace bpkg
                     const package_name& dependency,
                     database& dependency_db);
 
-  // As above but cache the result in a vector. This version should be used if
-  // query_dependents*() may be called recursively.
+  // As above but return the result as a vector. This version should be used
+  // if query_dependents*() may be called recursively.
+  //
+  // Note that rather than querying the database on each call, this version
+  // looks up the dependents in the in-memory reverse dependency index of the
+  // dependent configuration. The index is built from all the selected
+  // package prerequisites in this configuration on the first call in a
+  // transaction, is invalidated on any selected package change in this
+  // configuration, and is dropped when the transaction is finalized.
+  //
+  // Note: must be called inside the transaction.
   //
   vector<package_dependent>
   query_dependents_cache (database&, const package_name&, database&);
 
+  // Used to build the reverse dependency index (see query_dependents_cache()
+  // for details).
+  //
+  #pragma db view table("main.selected_package_prerequisites" = "pp")
+  struct package_dependent_prerequisite
+  {
+    #pragma db column("pp.package")
+    package_name name;
+
+    #pragma db column("pp.configuration")
+    string configuration; // Dependency configuration UUID.
+
+    #pragma db column("pp.prerequisite")
+    package_name prerequisite;
+
+    #pragma db column("pp.")
+    optional<bpkg::version_constraint> version_constraint;
+
+    #pragma db column("pp.type")
+    dependency_type type;
+  };
+
   // Database and package name pair.
   //
   // It is normally used as a key for maps containing data for packages across
@@ -14,6 +14,7 @@
 #include <bpkg/package.hxx>
 #include <bpkg/package-odb.hxx>
 #include <bpkg/database.hxx>
+#include <bpkg/profile.hxx>
 #include <bpkg/rep-mask.hxx>
 #include <bpkg/diagnostics.hxx>
 #include <bpkg/satisfaction.hxx>
@@ -1858,6 +1859,8 @@ namespace bpkg
 
     tracer trace ("collect_build");
 
+    profile_phase pp (&resolution_profile::collect_build);
+
     assert (pkg.repository_fragment == nullptr ||
             !rep_masked_fragment (pkg.repository_fragment));
 
@@ -2636,7 +2639,7 @@ namespace bpkg
 
       if (size_t n = deps.size ())
       {
-        pkg.dependencies->reserve (n);
+        pkg.dependencies.modify ().reserve (n);
         pkg.alternatives->reserve (n);
       }
 
@@ -2646,19 +2649,24 @@ namespace bpkg
     else
       l5 ([&]{trace << "resume " << pkg.available_name_version_db ();});
 
-    dependencies&   sdeps (*pkg.dependencies);
-    vector<size_t>& salts (*pkg.alternatives);
-
-    assert (sdeps.size () == salts.size ()); // Must be parallel.
+    assert (pkg.dependencies->size () == pkg.alternatives->size ());
 
     // Check if there is nothing to collect anymore.
     //
-    if (sdeps.size () == deps.size ())
+    if (pkg.dependencies->size () == deps.size ())
     {
       l5 ([&]{trace << "end " << pkg.available_name_version_db ();});
       return nullopt;
     }
 
+    // Note that the selected alternatives list can be shared with the
+    // package builds collection snapshots (see build_package::dependencies
+    // for details). Thus, we only obtain its modifiable reference once we
+    // know that it will be modified.
+    //
+    dependencies&   sdeps (pkg.dependencies.modify ());
+    vector<size_t>& salts (*pkg.alternatives);
+
     // Show how we got here if things go wrong.
     //
     // To suppress printing this information clear the dependency chain before
@@ -6343,6 +6351,8 @@ namespace bpkg
     //       variable if changing anything in this function.
     //
 
+    profile_phase pp (&resolution_profile::collect_build_postponed);
+
     // Snapshot of the package builds collection state.
     //
     // Note: should not include postponed_cfgs_history.
@@ -6393,6 +6403,9 @@ namespace bpkg
                postponed_configurations& postponed_cfgs,
                unsatisfied_dependents& unsatisfied_depts)
       {
+        if (profile != nullptr)
+          ++profile->snapshot_restores;
+
         pkgs               = move (pkgs_);
         replaced_vers      = move (replaced_vers_);
         dependency_constrs = move (dependency_constrs_);
@@ -6425,6 +6438,13 @@ namespace bpkg
       //       memory. We could probably optimize this some more if necessary
       //       (there are still sets/maps inside).
       //
+      // Note also that the selected dependency alternatives of the package
+      // builds, which normally dominate the package builds collection
+      // memory, are shared with the current state until modified (see
+      // build_package::dependencies for details). Thus, taking the snapshot
+      // only duplicates them for the packages which are (re-)collected
+      // before the state is restored.
+      //
       build_packages                  pkgs_;
       vector<package_key>             postponed_repo_;
       vector<package_key>             postponed_alts_;
@@ -7017,11 +7037,9 @@ namespace bpkg
         // collect_build_prerequisites() for details).
         //
         {
-          const bpkg::dependencies& deps  (b->available->dependencies);
-          bpkg::dependencies&       sdeps (*b->dependencies);
-          vector<size_t>&           salts (*b->alternatives);
+          const bpkg::dependencies& deps (b->available->dependencies);
 
-          size_t di (sdeps.size ());
+          size_t di (b->dependencies->size ());
 
           // Skip the dependent if it has been already collected as some
           // package's dependency or some such.
@@ -7034,6 +7052,13 @@ namespace bpkg
             continue;
           }
 
+          // Note that the selected dependency alternatives list can be
+          // shared with the package builds collection snapshots and is only
+          // duplicated here, if required.
+          //
+          bpkg::dependencies& sdeps (b->dependencies.modify ());
+          vector<size_t>&     salts (*b->alternatives);
+
           l5 ([&]{trace << "select cfg-negotiated dependency alternative "
                         << "for dependent "
                         << b->available_name_version_db ();});
@@ -8071,6 +8096,8 @@ namespace bpkg
          const function<find_database_function>& fdb,
          bool reorder)
   {
+    profile_phase pp (&resolution_profile::order);
+
     package_refs chain;
     return order (db, name, chain, fdb, reorder);
   }
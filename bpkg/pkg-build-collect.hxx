@@ -34,6 +34,66 @@ namespace bpkg
   using repointed_dependents =
     std::map<package_key, std::map<package_key, bool>>;
 
+  // Optional value which is shared between the object copies until it is
+  // modified (copy-on-write). The value can only be modified via modify(),
+  // which first makes a private copy of the value if it is shared.
+  //
+  // Used for the potentially large build_package members which are normally
+  // not modified after the package builds collection state snapshot is taken
+  // (see build_packages::collect_build_postponed() for details). This way
+  // only the modified values end up being duplicated.
+  //
+  // Note that a reference returned by modify() must not be used after the
+  // object is copied.
+  //
+  template <typename T>
+  class cow_optional
+  {
+  public:
+    cow_optional () = default;
+    cow_optional (butl::nullopt_t) {}
+
+    cow_optional&
+    operator= (T v)
+    {
+      p_ = make_shared<T> (move (v));
+      return *this;
+    }
+
+    cow_optional&
+    operator= (butl::nullopt_t)
+    {
+      p_.reset ();
+      return *this;
+    }
+
+    bool
+    has_value () const {return p_ != nullptr;}
+
+    explicit
+    operator bool () const {return p_ != nullptr;}
+
+    const T&
+    operator* () const {return *p_;}
+
+    const T*
+    operator-> () const {return p_.get ();}
+
+    T&
+    modify ()
+    {
+      assert (p_ != nullptr);
+
+      if (p_.use_count () != 1)
+        p_ = make_shared<T> (*p_);
+
+      return *p_;
+    }
+
+  private:
+    shared_ptr<T> p_;
+  };
+
   // A "dependency-ordered" list of packages and their prerequisites.
   // That is, every package on the list only possibly depending on the
   // ones after it. In a nutshell, the usage is as follows: we first
@@ -135,7 +195,11 @@ namespace bpkg
     // builds collection is postponed for any reason (see postponed_packages
     // and postponed_configurations for possible reasons).
     //
-    optional<bpkg::dependencies> dependencies;
+    // Note that the dependency alternatives are only appended to this list
+    // and are shared between the package builds collection snapshots (see
+    // cow_optional for details).
+    //
+    cow_optional<bpkg::dependencies> dependencies;
 
     // Indexes of the selected dependency alternatives stored in the above
     // dependencies member.
@@ -14,6 +14,7 @@
 
 #include <bpkg/package.hxx>
 #include <bpkg/package-odb.hxx>
+#include <bpkg/profile.hxx>
 #include <bpkg/database.hxx>
 #include <bpkg/diagnostics.hxx>
 #include <bpkg/fetch-cache.hxx>
@@ -3428,6 +3429,148 @@ namespace bpkg
       cs.append ("<null>");
   }
 
+  // Return the fingerprint of the pkg-build command line and of the states
+  // of the current configurations and the configurations they are linked
+  // with (see --skip-unchanged for details) or nullopt if the state cannot be
+  // fingerprinted reliably. The latter is the case if any of these
+  // configurations contain system or external packages or non-version
+  // control-based directory repositories since their contents can change
+  // without their database state changing.
+  //
+  static optional<string>
+  plan_fingerprint (database& mdb)
+  {
+    xxh64 cs;
+
+    cs.append (BPKG_VERSION_STR);
+
+    cs.append (cmd_args.size ());
+    for (const string& a: cmd_args)
+      cs.append (a);
+
+    transaction t (mdb);
+
+    linked_databases dbs;
+    for (database& cdb: current_configs)
+    {
+      for (database& db: cdb.cluster_configs (true /* sys_rep */))
+      {
+        if (find (dbs.begin (), dbs.end (), db) == dbs.end ())
+          dbs.push_back (db);
+      }
+    }
+
+    for (database& db: dbs)
+    {
+      cs.append (db.uuid.string ());
+
+      for (const repository_fragment& f: db.query<repository_fragment> ())
+      {
+        if (!f.location.empty ()                       &&
+            f.location.type () != repository_type::git &&
+            !f.packages_checksum)
+          return nullopt;
+
+        cs.append (f.name);
+
+        if (f.packages_checksum)
+          cs.append (*f.packages_checksum);
+
+        for (const auto& r: f.complements)
+          cs.append (r.object_id ());
+
+        for (const auto& r: f.prerequisites)
+          cs.append (r.object_id ());
+      }
+
+      for (const selected_package& p: db.query<selected_package> ())
+      {
+        if (p.system () || p.external ())
+          return nullopt;
+
+        cs.append (p.name.string ());
+        cs.append (p.version.string ());
+        cs.append (to_string (p.state));
+        cs.append (to_string (p.substate));
+        cs.append (p.hold_package);
+        cs.append (p.hold_version);
+        cs.append (p.config_checksum);
+
+        if (!p.repository_fragment.empty ())
+          cs.append (p.repository_fragment.canonical_name ());
+
+        for (const auto& pp: p.prerequisites)
+        {
+          cs.append (pp.first.object_id ().string ());
+
+          if (const optional<version_constraint>& c =
+                pp.second.version_constraint)
+            cs.append (c->string ());
+        }
+      }
+    }
+
+    t.commit ();
+
+    return cs.string ();
+  }
+
+  static const path plan_fingerprint_file (
+    dir_path (bpkg_dir) /= "plan-fingerprint.txt");
+
+  // Return true if the fingerprint matches the one saved in the specified
+  // configuration by the last successful pkg-build run.
+  //
+  static bool
+  plan_fingerprint_matches (const dir_path& c, const string& fp)
+  {
+    path f (c / plan_fingerprint_file);
+
+    if (!exists (f, true /* ignore_error */))
+      return false;
+
+    try
+    {
+      ifdstream is (f);
+      string l;
+      getline (is, l);
+      is.close ();
+
+      return l == fp;
+    }
+    catch (const io_error& e)
+    {
+      warn << "unable to read from " << f << ": " << e;
+      return false;
+    }
+  }
+
+  // Save the fingerprint into the specified configuration or remove the
+  // stale one if the fingerprint is absent. Issue a warning on error.
+  //
+  static void
+  save_plan_fingerprint (const dir_path& c, const optional<string>& fp)
+  {
+    path f (c / plan_fingerprint_file);
+
+    if (!fp)
+    {
+      try_rmfile (f, true /* ignore_error */);
+      return;
+    }
+
+    try
+    {
+      ofdstream os (f);
+      os << *fp << '\n';
+      os.close ();
+    }
+    catch (const io_error& e)
+    {
+      warn << "unable to write to " << f << ": " << e;
+    }
+  }
+
   int
   pkg_build (const pkg_build_options& o, cli::group_scanner& args)
   {
@@ -3458,6 +3601,15 @@ namespace bpkg
         fail << "--noop-exit is only supported in --configure-only mode";
     }
 
+    if (o.skip_unchanged ())
+    {
+      if (o.print_only ())
+        fail << "--skip-unchanged specified with --print-only";
+
+      if (o.rebuild_checksum_specified ())
+        fail << "--skip-unchanged specified with --rebuild-checksum";
+    }
+
     if (o.update_dependent () && o.leave_dependent ())
       fail << "both --update-dependent|-U and --leave-dependent|-L "
            << "specified" <<
@@ -3471,6 +3623,32 @@ namespace bpkg
       fail << "package name argument expected" <<
         info << "run 'bpkg help pkg-build' for more information";
 
+    // Install the resolution profile, if requested, and print/write it on
+    // return, whether successful or not.
+    //
+    optional<resolution_profile> prof;
+
+    if (o.profile () || o.profile_file_specified ())
+    {
+      prof = resolution_profile ();
+      profile = &*prof;
+    }
+
+    auto prof_guard (
+      make_guard ([&prof, &o] ()
+                  {
+                    if (prof)
+                    {
+                      profile = nullptr;
+
+                      if (o.profile ())
+                        prof->print ();
+
+                      if (o.profile_file_specified ())
+                        prof->write (o.profile_file ());
+                    }
+                  }));
+
     // If multiple current configurations are specified, then open the first
     // one, attach the remaining, verify that their schemas match (which may
     // not be the case if they don't belong to the same linked database
@@ -4003,6 +4181,17 @@ namespace bpkg
                 o.mask_repository_uuid (),
                 current_configs);
 
+    // Now, as the repositories are fetched and masked, the available packages
+    // won't change anymore during this build and so we can look them up in
+    // the in-memory index rather than querying the databases over and over
+    // again during the dependency resolution.
+    //
+    available_package_index avail_index;
+    available_index = &avail_index;
+
+    auto avail_index_guard (
+      make_guard ([] () {available_index = nullptr;}));
+
     // Expand the package specs into individual package args, parsing them
     // into the package scheme, name, and version constraint components, and
     // also saving associated options and configuration variables.
@@ -4148,6 +4337,35 @@ namespace bpkg
       return r;
     };
 
+    // Return the system package manager or NULL if we should not query it,
+    // creating it on the first call.
+    //
+    // Note that the system package manager is shared between all the
+    // configurations, so use the main configuration's fetch cache settings.
+    //
+    auto sys_package_manager = [&o, &mdb] () -> system_package_manager*
+    {
+      if (!sys_pkg_mgr)
+        sys_pkg_mgr = o.sys_no_query ()
+          ? nullptr
+          : make_consumption_system_package_manager (o,
+                                                     &mdb,
+                                                     host_triplet,
+                                                     o.sys_distribution (),
+                                                     o.sys_architecture (),
+                                                     o.sys_install (),
+                                                     !o.sys_no_fetch (),
+                                                     o.sys_yes (),
+                                                     o.sys_sudo ());
+
+      return sys_pkg_mgr->get ();
+    };
+
+    // Available packages collected for the system packages whose status was
+    // prefetched (see below).
+    //
+    map<package_name, available_packages> sys_available;
+
     // Figure out the system package version unless explicitly specified and
     // add the system package authoritative information to the database's
     // system repository unless the database is NULL or it already contains
@@ -4157,11 +4375,12 @@ namespace bpkg
     // Note that it is assumed that all the possible duplicates are handled
     // elsewhere/later.
     //
-    auto add_system_package = [&o] (database* db,
-                                    const package_name& nm,
-                                    optional<version_constraint> vc,
-                                    const system_package_status* sps,
-                                    vector<shared_ptr<available_package>>* stubs)
+    auto add_system_package = [&o, &sys_package_manager, &sys_available]
+                              (database* db,
+                               const package_name& nm,
+                               optional<version_constraint> vc,
+                               const system_package_status* sps,
+                               vector<shared_ptr<available_package>>* stubs)
       -> pair<version_constraint, const system_package_status*>
     {
       if (!vc)
@@ -4170,20 +4389,9 @@ namespace bpkg
 
         // See if we should query the system package manager.
         //
-        if (!sys_pkg_mgr)
-          sys_pkg_mgr = o.sys_no_query ()
-            ? nullptr
-            : make_consumption_system_package_manager (o,
-                                                       host_triplet,
-                                                       o.sys_distribution (),
-                                                       o.sys_architecture (),
-                                                       o.sys_install (),
-                                                       !o.sys_no_fetch (),
-                                                       o.sys_yes (),
-                                                       o.sys_sudo ());
-        if (*sys_pkg_mgr != nullptr)
-        {
-          system_package_manager& spm (**sys_pkg_mgr);
+        if (system_package_manager* m = sys_package_manager ())
+        {
+          system_package_manager& spm (*m);
 
           // First check the cache.
           //
@@ -4193,9 +4401,16 @@ namespace bpkg
           if (!os)
           {
             // If no cache hit, then collect the available packages for the
-            // mapping information.
+            // mapping information, unless already collected.
             //
-            aps = find_available_all (current_configs, nm);
+            auto i (sys_available.find (nm));
+            if (i != sys_available.end ())
+            {
+              aps = move (i->second);
+              sys_available.erase (i);
+            }
+            else
+              aps = find_available_all (current_configs, nm);
 
             // If no source/stub for the package (and thus no mapping), issue
             // diagnostics consistent with other such places unless explicitly
@@ -4404,6 +4619,67 @@ namespace bpkg
         return r;
       };
 
+      // Prefetch the status of the system packages specified without
+      // version (and which will thus be queried from the system package
+      // manager; see add_system_package() for details), so that the system
+      // package manager can query all of them at once.
+      //
+      // Note that we only consider the plain package names here, leaving the
+      // diagnostics of invalid package specifications to the parsing below.
+      //
+      if (!o.sys_no_query ())
+      {
+        vector<pair<package_name, available_packages>> sps;
+
+        for (const pkg_spec& ps: specs)
+        {
+          if (!ps.location.empty ())
+            continue;
+
+          const char* s (ps.packages.c_str ());
+
+          if (parse_package_scheme (s) != package_scheme::sys)
+            continue;
+
+          package_name n;
+
+          try
+          {
+            n = package_name (s);
+          }
+          catch (const invalid_argument&)
+          {
+            continue;
+          }
+
+          if (find_if (sps.begin (), sps.end (),
+                       [&n] (const pair<package_name, available_packages>& p)
+                       {
+                         return p.first == n;
+                       }) != sps.end ())
+            continue;
+
+          // Skip the unknown package, unless allowed, for it to be diagnosed
+          // during the parsing.
+          //
+          available_packages aps (find_available_all (current_configs, n));
+
+          if (!aps.empty () || o.sys_no_stub ())
+            sps.emplace_back (move (n), move (aps));
+        }
+
+        if (!sps.empty ())
+        {
+          if (system_package_manager* spm = sys_package_manager ())
+          {
+            spm->status_prefetch (sps);
+
+            for (auto& p: sps)
+              sys_available.emplace (move (p.first), move (p.second));
+          }
+        }
+      }
+
       for (pkg_spec& ps: specs)
       {
         if (ps.location.empty ())
@@ -5738,6 +6014,32 @@ namespace bpkg
       return 0;
     }
 
+    // If requested, skip the plan computation altogether if nothing changed
+    // since the last successful run with the same command line. Otherwise,
+    // arrange to save the fingerprint of the resulting state on success.
+    //
+    if (o.skip_unchanged ())
+    {
+      optional<string> fp (plan_fingerprint (mdb));
+
+      if (fp && plan_fingerprint_matches (mdb.config, *fp))
+      {
+        l4 ([&]{trace << "plan fingerprint " << *fp << " matches";});
+
+        if (o.noop_exit_specified ())
+          return o.noop_exit ();
+
+        info << "nothing changed since last build";
+        return 0;
+      }
+    }
+
+    auto save_fingerprint = [&o, &mdb] ()
+    {
+      if (o.skip_unchanged ())
+        save_plan_fingerprint (mdb.config, plan_fingerprint (mdb));
+    };
+
     // Search for the package prerequisite among packages specified on the
     // command line and, if found, return its desired database. Return NULL
     // otherwise. The `db` argument specifies the dependent database.
@@ -5829,6 +6131,12 @@ namespace bpkg
     //
     // Package managers are an easy, already solved problem, right?
     //
+    // Note that the skeleton evaluation memo outlives the plan refinement
+    // (see below) since the new evaluation results are only saved after the
+    // plan is successfully executed.
+    //
+    package_skeleton::evaluation_memo skel_memo;
+
     build_packages pkgs;
     {
       vector<replaced_dependency> replaced_deps;
@@ -5962,6 +6270,27 @@ namespace bpkg
       //
       uint64_t cmdline_adjs_iteration (0);
 
+      // Memoize the package skeleton clause evaluations for the duration of
+      // the plan refinement, which re-collects the package builds from
+      // scratch over and over again. Note that the plan execution is only
+      // simulated here and thus the package configurations don't change on
+      // disk (see package_skeleton::evaluation_memo for details).
+      //
+      package_skeleton::memo = &skel_memo;
+
+      auto skel_memo_guard (
+        make_guard ([&skel_memo, &trace] ()
+                    {
+                      package_skeleton::memo = nullptr;
+                      skel_memo.clear_contexts ();
+
+                      l4 ([&]{trace << "skeleton evaluation memo: "
+                                    << skel_memo.hits << " hits, "
+                                    << skel_memo.misses << " misses, "
+                                    << skel_memo.context_hits
+                                    << " context hits";});
+                    }));
+
       // Iteratively refine the plan with dependency up/down-grades/drops.
       //
       // Note that we should not clean the replaced_deps list on scratch_col
@@ -5983,6 +6312,9 @@ namespace bpkg
         l4 ([&]{trace << "refine package collection/plan execution"
                       << (scratch ? " from scratch" : "");});
 
+        if (profile != nullptr)
+          ++profile->refinements;
+
         // Prepare for the re-collection.
         //
         if (scratch)
@@ -6631,6 +6963,9 @@ namespace bpkg
           //
           scratch_col = true;
 
+          if (profile != nullptr)
+            ++profile->scratch_collections;
+
           l5 ([&]{trace << "collection failed due to " << e.description
                         << (e.package != nullptr
                             ? " (" + e.package->string () + ')'
@@ -8293,8 +8628,17 @@ namespace bpkg
                               nullptr /* simulate */,
                               find_prereq_database));
 
+    // Save the new enable clause evaluation results for the subsequent runs.
+    // Note that we only do this now so that the configurations are left
+    // untouched if the user declines the plan or its execution fails.
+    //
+    skel_memo.save ();
+
     if (o.configure_only ())
+    {
+      save_fingerprint ();
       return noop && o.noop_exit_specified () ? o.noop_exit () : 0;
+    }
 
     // update
     //
@@ -8364,6 +8708,7 @@ namespace bpkg
         text << "updated " << pv.string ();
     }
 
+    save_fingerprint ();
     return 0;
   }
 
@@ -8377,6 +8722,8 @@ namespace bpkg
 
     l4 ([&]{trace << "simulate: " << (simulate ? "yes" : "no");});
 
+    profile_phase pp (&resolution_profile::execute_plan);
+
     // If unsatisfied dependents are specified then we are in the simulation
     // mode and thus simulate can be used as bool.
 
@@ -8715,6 +9062,207 @@ namespace bpkg
       }
     };
 
+    // Go through the package repository fragments to decide if we should
+    // fetch, checkout or unpack depending on the available repository basis
+    // and based on the fact whether the fetch cache is enabled or not.
+    //
+    // Note that for the git repository the package commit is always already
+    // fetched at this point, regardless whether it comes from the
+    // configuration-specific or global fetch cache. However, the submodules,
+    // if present, may not be fetched yet, but will be fetched on the first
+    // checkout (and then the commit data becomes fully local).
+    //
+    // Also note that if the fetch cache is enabled, then for an archive-based
+    // repository the package archive becomes local after the first fetch. So
+    // based on this it is tempting to always prefer archive over git checkout
+    // if fetch cache is enabled. However, what this would break is the sloppy
+    // but common pattern of cloning the package locally, changing something
+    // without changing the version, adding this package as a local repository
+    // of type git or dir, and ... the package would still come from the
+    // archive. Also, probably fetching from local git is still faster than
+    // fetching from remote archive.
+    //
+    // Note also that checking for the archive presence in the cache is likely
+    // a bad idea since it's quite expensive (and we could be simulating).
+    //
+    // The overall preference order of the package repositories is as follows:
+    //
+    // 1: (local) directory-based
+    // 2:  local  version control-based
+    // 3:  local  archive-based
+    //
+    // If fetch cache is enabled:
+    //   4:  remote archive-based
+    //   5:  remote version control-based
+    //
+    // Otherwise:
+    //   4:  remote version control-based
+    //   5:  remote archive-based
+    //
+    auto pref_order = [&fetch_cache, &fetch_cache_mode]
+                      (database& pdb, const repository_location& rl) -> int
+    {
+      if (rl.directory_based ())
+        return 1;
+
+      if (rl.local ())
+      {
+        if (rl.version_control_based ())
+          return 2;
+
+        assert (rl.archive_based ()); // Wouldn't be here otherwise.
+        return 3;
+      }
+
+      fetch_cache_mode (pdb);
+
+      if (fetch_cache.enabled ())
+      {
+        if (rl.archive_based ())
+          return 4;
+
+        assert (rl.version_control_based ()); // Wouldn't be here otherwise.
+      }
+      else
+      {
+        if (rl.version_control_based ())
+          return 4;
+
+        assert (rl.archive_based ()); // Wouldn't be here otherwise.
+      }
+
+      return 5;
+    };
+
+    // Return the preferred repository of the package.
+    //
+    auto pref_repository = [&pref_order]
+                           (database& pdb,
+                            const shared_ptr<available_package>& ap)
+                           -> const repository_location*
+    {
+      const repository_location* r (nullptr);
+
+      for (const package_location& l: ap->locations)
+      {
+        if (!rep_masked_fragment (l.repository_fragment))
+        {
+          const repository_location& rl (
+            l.repository_fragment.load ()->location);
+
+          int po (pref_order (pdb, rl));
+          if (r == nullptr || po < pref_order (pdb, *r))
+          {
+            r = &rl;
+
+            // Bail out if the preference order can't be less.
+            //
+            if (po == 1)
+              break;
+          }
+        }
+      }
+
+      return r;
+    };
+
+    // If requested, download the archives of the packages which need to be
+    // fetched from the remote archive-based repositories in the background,
+    // concurrently (see --fetch-jobs for details). Note that the downloaded
+    // archives are still verified and the packages are still fetched and
+    // unpacked (while the remaining archives are being downloaded) in the
+    // loop below, in order.
+    //
+    // Note that the decision on which archives to download must be in sync
+    // with the loop below and pkg_fetch(). If that's not the case for some
+    // reason, then the mismatching archive is just not used.
+    //
+    archive_prefetcher prefetcher (o, parallel_jobs (o.fetch_jobs ()));
+
+    if (!simulate && prefetcher.jobs () > 1 && !fetch_cache::offline (o))
+    {
+      set<package_id> cached; // Packages which will be cached when fetched.
+
+      for (const build_package& p: reverse_iterate (build_pkgs))
+      {
+        assert (p.action);
+
+        if (*p.action != build_package::build || p.system)
+          continue;
+
+        database& pdb (p.db);
+        const shared_ptr<selected_package>& sp (p.selected);
+        const shared_ptr<available_package>& ap (p.available);
+
+        if (sp != nullptr                         &&
+            sp->version == p.available_version () &&
+            !p.replace ())
+          continue;
+
+        assert (ap != nullptr && !ap->locations.empty ());
+
+        if (ap->locations[0].repository_fragment.object_id () == "")
+          continue;
+
+        // Note that the repository fragments are loaded lazily.
+        //
+        const package_location* pl (nullptr);
+        {
+          transaction t (pdb);
+
+          const repository_location* prl (pref_repository (pdb, ap));
+
+          if (prl != nullptr && prl->archive_based () && prl->remote ())
+          {
+            // Since there is no local archive-based repository for the
+            // package (see pref_order() for details), pkg_fetch() picks the
+            // first unmasked archive-based repository fragment.
+            //
+            for (const package_location& l: ap->locations)
+            {
+              if (!rep_masked_fragment (l.repository_fragment) &&
+                  l.repository_fragment.load ()->location.archive_based ())
+              {
+                pl = &l;
+                break;
+              }
+            }
+
+            assert (pl != nullptr);
+          }
+
+          t.commit ();
+        }
+
+        if (pl == nullptr)
+          continue;
+
+        // Skip the package if its archive is already in the fetch cache or
+        // will be there once the package is fetched into some other
+        // configuration.
+        //
+        fetch_cache_mode (pdb);
+
+        if (fetch_cache.enabled ())
+        {
+          if (!fetch_cache.is_open ())
+            fetch_cache.open (trace);
+
+          if (!cached.insert (ap->id).second ||
+              fetch_cache.peek_pkg_repository_package (ap->id))
+            continue;
+        }
+
+        prefetcher.add (pdb,
+                        ap->id.name,
+                        p.available_version (),
+                        pl->repository_fragment->location,
+                        pl->location);
+      }
+
+      prefetcher.start ();
+    }
+
     for (build_package& p: reverse_iterate (build_pkgs))
     {
       assert (p.action);
@@ -8845,103 +9393,9 @@ namespace bpkg
               t.start (pdb);
 
             // Go through package repository fragments to decide if we should
-            // fetch, checkout or unpack depending on the available repository
-            // basis and based on the fact whether the fetch cache is enabled
-            // or not.
-            //
-            // Note that for the git repository the package commit is always
-            // already fetched at this point, regardless whether it comes from
-            // the configuration-specific or global fetch cache. However, the
-            // submodules, if present, may not be fetched yet, but will be
-            // fetched on the first checkout (and then the commit data becomes
-            // fully local).
-            //
-            // Also note that if the fetch cache is enabled, then for an
-            // archive-based repository the package archive becomes local
-            // after the first fetch. So based on this it is tempting to
-            // always prefer archive over git checkout if fetch cache is
-            // enabled. However, what this would break is the sloppy but
-            // common pattern of cloning the package locally, changing
-            // something without changing the version, adding this package as
-            // a local repository of type git or dir, and ... the package
-            // would still come from the archive. Also, probably fetching from
-            // local git is still faster than fetching from remote archive.
+            // fetch, checkout or unpack (see pref_repository() for details).
             //
-            // Note also that checking for the archive presence in the cache
-            // is likely a bad idea since it's quite expensive (and we could
-            // be simulating).
-            //
-            // The overall preference order of the package repositories is as
-            // follows:
-            //
-            // 1: (local) directory-based
-            // 2:  local  version control-based
-            // 3:  local  archive-based
-            //
-            // If fetch cache is enabled:
-            //   4:  remote archive-based
-            //   5:  remote version control-based
-            //
-            // Otherwise:
-            //   4:  remote version control-based
-            //   5:  remote archive-based
-            //
-            auto pref_order = [&fetch_cache, &fetch_cache_mode, &pdb]
-                              (const repository_location& rl) -> int
-            {
-              if (rl.directory_based ())
-                return 1;
-
-              if (rl.local ())
-              {
-                if (rl.version_control_based ())
-                  return 2;
-
-                assert (rl.archive_based ()); // Wouldn't be here otherwise.
-                return 3;
-              }
-
-              fetch_cache_mode (pdb);
-
-              if (fetch_cache.enabled ())
-              {
-                if (rl.archive_based ())
-                  return 4;
-
-                assert (rl.version_control_based ()); // Wouldn't be here otherwise.
-              }
-              else
-              {
-                if (rl.version_control_based ())
-                  return 4;
-
-                assert (rl.archive_based ()); // Wouldn't be here otherwise.
-              }
-
-              return 5;
-            };
-
-            const repository_location* prl (nullptr);
-
-            for (const package_location& l: ap->locations)
-            {
-              if (!rep_masked_fragment (l.repository_fragment))
-              {
-                const repository_location& rl (
-                  l.repository_fragment.load ()->location);
-
-                int po (pref_order (rl));
-                if (prl == nullptr || po < pref_order (*prl))
-                {
-                  prl = &rl;
-
-                  // Bail out if the preference order can't be less.
-                  //
-                  if (po == 1)
-                    break;
-                }
-              }
-            }
+            const repository_location* prl (pref_repository (pdb, ap));
 
             assert (prl != nullptr); // Shouldn't be here otherwise.
 
@@ -8971,7 +9425,8 @@ namespace bpkg
                                 p.available_version (),
                                 true /* replace */,
                                 simulate,
-                                !simulate /* keep_transaction_if_safe */);
+                                !simulate /* keep_transaction_if_safe */,
+                                &prefetcher);
                 break;
               }
             case repository_basis::version_control:
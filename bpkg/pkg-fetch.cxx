@@ -232,6 +232,253 @@ namespace bpkg
                       keep_transaction_if_safe);
   }
 
+  // archive_prefetcher
+  //
+  // The diagnostics stream which, for the threads which requested that, adds
+  // the diagnostics to the thread-specific buffer and passes it through to
+  // the original stream otherwise.
+  //
+  class archive_prefetcher::diag_buffer: public streambuf
+  {
+  public:
+    explicit
+    diag_buffer (ostream& os): os_ (os), stream_ (this) {}
+
+    ostream&
+    stream () {return stream_;}
+
+    // The buffer for the current thread diagnostics or NULL if it should be
+    // passed through.
+    //
+    static thread_local string* buffer;
+
+  protected:
+    virtual int_type
+    overflow (int_type c) override
+    {
+      if (c != traits_type::eof ())
+      {
+        char ch (traits_type::to_char_type (c));
+
+        if (buffer != nullptr)
+          buffer->push_back (ch);
+        else if (!os_.put (ch))
+          return traits_type::eof ();
+      }
+
+      return traits_type::not_eof (c);
+    }
+
+    virtual streamsize
+    xsputn (const char* s, streamsize n) override
+    {
+      if (buffer != nullptr)
+        buffer->append (s, static_cast<size_t> (n));
+      else if (!os_.write (s, n))
+        return 0;
+
+      return n;
+    }
+
+    virtual int
+    sync () override
+    {
+      return buffer != nullptr || os_.flush () ? 0 : -1;
+    }
+
+  private:
+    ostream& os_;
+    ostream  stream_;
+  };
+
+  thread_local string* archive_prefetcher::diag_buffer::buffer (nullptr);
+
+  archive_prefetcher::
+  archive_prefetcher (const common_options& co, size_t jobs)
+      : options_ (co), jobs_ (jobs)
+  {
+    options_.progress (false);
+    options_.no_progress (true);
+  }
+
+  archive_prefetcher::
+  ~archive_prefetcher ()
+  {
+    if (thread_.joinable ())
+    {
+      {
+        mlock l (mutex_);
+        stop_ = true;
+      }
+
+      thread_.join ();
+    }
+
+    if (diag_stream_ != nullptr)
+      diag_stream = diag_stream_;
+  }
+
+  void archive_prefetcher::
+  add (database& db,
+       const package_name& n,
+       const version& v,
+       const repository_location& rl,
+       const path& l)
+  {
+    assert (!thread_.joinable ());
+
+    items_.push_back (item {&db, n, v, rl, l});
+  }
+
+  void archive_prefetcher::
+  start ()
+  {
+    assert (!thread_.joinable ());
+
+    if (items_.empty ())
+      return;
+
+    // Note that we download the archives using up to the jobs number of
+    // threads, including the background thread itself.
+    //
+    // If we fail to start the background thread, then just fall back to
+    // downloading the archives serially (see take() for details).
+    //
+    // Note that the diagnostics stream is replaced before the thread is
+    // started and is restored after it is joined (see the destructor).
+    //
+    diag_buffer_.reset (new diag_buffer (*diag_stream));
+    diag_stream_ = diag_stream;
+    diag_stream = &diag_buffer_->stream ();
+
+    try
+    {
+      thread_ = thread ([this] ()
+                        {
+                          parallel_for (items_.size (),
+                                        jobs_,
+                                        [this] (size_t i) {download (i);});
+                        });
+    }
+    catch (const system_error&)
+    {
+      diag_stream = diag_stream_;
+      diag_stream_ = nullptr;
+
+      items_.clear ();
+    }
+  }
+
+  void archive_prefetcher::
+  download (size_t i)
+  {
+    item& it (items_[i]);
+
+    {
+      mlock l (mutex_);
+
+      if (stop_)
+      {
+        it.status = state::skipped;
+        condv_.notify_all ();
+        return;
+      }
+    }
+
+    archive r;
+    state s (state::done);
+    string d;
+
+    // Buffer the diagnostics since the failed download may end up not being
+    // used (see take() for details).
+    //
+    diag_buffer::buffer = &d;
+    auto dg (make_guard ([] () {diag_buffer::buffer = nullptr;}));
+
+    // Note that the temporary directory map is not modified while the
+    // archives are being downloaded.
+    //
+    try
+    {
+      r.file = tmp_file (it.db->config_orig,
+                         it.name.string () + '-' + it.version.string ());
+
+      pkg_fetch_archive (options_, it.repository, it.location, r.file.path);
+
+      r.checksum = sha256sum (options_, r.file.path);
+    }
+    catch (const failed&)
+    {
+      s = state::failed;
+    }
+    catch (const std::exception& e)
+    {
+      // Don't let the exception escape the download thread (which would
+      // terminate the process) and report it on the main thread instead
+      // (see take() for details).
+      //
+      error << "unable to fetch package " << it.name << ' ' << it.version
+            << ": " << e;
+
+      s = state::failed;
+    }
+
+    mlock l (mutex_);
+    it.result = move (r);
+    it.status = s;
+    it.diag = move (d);
+    condv_.notify_all ();
+  }
+
+  optional<archive_prefetcher::archive> archive_prefetcher::
+  take (database& db,
+        const package_name& n,
+        const version& v,
+        const repository_location& rl,
+        const path& l)
+  {
+    if (!thread_.joinable ())
+      return nullopt;
+
+    for (item& it: items_)
+    {
+      if (it.db == &db && it.name == n && it.version == v)
+      {
+        // Skip the archive if it has been downloaded from some other
+        // location, for example, due to a repository being masked after it
+        // has been scheduled.
+        //
+        if (it.repository.url () != rl.url () || it.location != l)
+          return nullopt;
+
+        mlock lk (mutex_);
+        condv_.wait (lk, [&it] {return it.status != state::pending;});
+
+        switch (it.status)
+        {
+        case state::done:
+          {
+            it.status = state::skipped; // Taken.
+            return move (it.result);
+          }
+        case state::failed:
+          {
+            // Print the buffered diagnostics.
+            //
+            *diag_stream << it.diag << flush;
+            throw failed ();
+          }
+        case state::skipped:
+        case state::pending: break;
+        }
+
+        return nullopt;
+      }
+    }
+
+    return nullopt;
+  }
+
   shared_ptr<selected_package>
   pkg_fetch (const common_options& co,
              fetch_cache& cache,
@@ -242,7 +489,8 @@ namespace bpkg
              version v,
              bool replace,
              bool simulate,
-             bool keep_transaction_if_safe)
+             bool keep_transaction_if_safe,
+             archive_prefetcher* prefetcher)
   {
     assert (session::has_current ());
 
@@ -444,13 +692,36 @@ namespace bpkg
         //
         assert (!cache.offline ());
 
-        if (cache.enabled ()) cache.start_gc ();
-        pkg_fetch_archive (co, rl, pl->location, a);
-        if (cache.enabled ()) cache.stop_gc ();
+        optional<archive_prefetcher::archive> pa (
+          prefetcher != nullptr
+          ? prefetcher->take (pdb, n, v, rl, pl->location)
+          : nullopt);
+
+        if (pa)
+        {
+          // Note that we hardlink rather than move the prefetched archive
+          // for the same reason we don't fetch into a temporary file (see
+          // above).
+          //
+          if (exists (a))
+            fail << "file " << a << " already exists";
 
-        arm = auto_rmfile (a);
+          clone_or_hardlink (pa->file.path, a);
 
-        fcs = sha256sum (co, a);
+          arm = auto_rmfile (a);
+
+          fcs = move (pa->checksum);
+        }
+        else
+        {
+          if (cache.enabled ()) cache.start_gc ();
+          pkg_fetch_archive (co, rl, pl->location, a);
+          if (cache.enabled ()) cache.stop_gc ();
+
+          arm = auto_rmfile (a);
+
+          fcs = sha256sum (co, a);
+        }
 
         if (fcs != *ap->sha256sum)
         {
@@ -509,7 +780,7 @@ namespace bpkg
         }
         else
         {
-          hardlink (ca, a);
+          clone_or_hardlink (ca, a);
 
           arm = auto_rmfile (a);
 
@@ -42,12 +42,118 @@ namespace bpkg
              bool simulate,
              bool keep_transaction_if_safe);
 
+  // Download package archives from remote archive-based repositories in the
+  // background, ahead of time, using up to the specified number of threads
+  // (see --fetch-jobs for details). The downloaded archives are then picked
+  // up by the pkg_fetch() function below instead of downloading them
+  // serially.
+  //
+  // Note that the progress of such concurrent downloads is not displayed and
+  // the downloaded archive checksums are verified by pkg_fetch(). Also note
+  // that the diagnostics issued while downloading an archive is buffered and
+  // is only printed if the archive download failure is reported by take().
+  //
+  class archive_prefetcher
+  {
+  public:
+    archive_prefetcher (const common_options&, size_t jobs);
+
+    // Wait for the archives being currently downloaded, skipping those which
+    // are not started yet, and remove all the archives which have not been
+    // taken.
+    //
+    ~archive_prefetcher ();
+
+    size_t
+    jobs () const {return jobs_;}
+
+    // Schedule the package archive download into the configuration's
+    // temporary directory. Should only be called before start().
+    //
+    void
+    add (database&,
+         const package_name&,
+         const version&,
+         const repository_location&,
+         const path& location);
+
+    // Start downloading the scheduled archives in the background, in the
+    // order they have been added.
+    //
+    void
+    start ();
+
+    // If the package archive has been scheduled for download from the
+    // specified location, then wait for the download to complete and return
+    // the downloaded archive and its checksum. Throw failed if the download
+    // has failed (the diagnostics has already been issued). Otherwise, return
+    // nullopt.
+    //
+    struct archive
+    {
+      auto_rmfile file;
+      string      checksum;
+    };
+
+    optional<archive>
+    take (database&,
+          const package_name&,
+          const version&,
+          const repository_location&,
+          const path& location);
+
+    archive_prefetcher (const archive_prefetcher&) = delete;
+    archive_prefetcher& operator= (const archive_prefetcher&) = delete;
+
+  private:
+    void
+    download (size_t);
+
+  private:
+    common_options options_; // With progress suppressed.
+    size_t jobs_;
+
+    enum class state {pending, done, failed, skipped};
+
+    struct item
+    {
+      database*           db;
+      package_name        name;
+      bpkg::version       version;
+      repository_location repository;
+      path                location;
+
+      state               status = state::pending;
+      archive             result;
+      string              diag; // Buffered download diagnostics.
+    };
+
+    vector<item> items_; // Not modified after start() (except under lock).
+
+    // The diagnostics stream which is installed while the archives are being
+    // downloaded and the original stream it replaces (see download() for
+    // details).
+    //
+    class diag_buffer;
+
+    unique_ptr<diag_buffer> diag_buffer_;
+    ostream*                diag_stream_ = nullptr;
+
+    bool stop_ = false;
+    mutex mutex_;
+    condition_variable condv_;
+    thread thread_; // Not joinable if not started.
+  };
+
   // Fetch the package from an archive-based repository and commit the
   // transaction if keep_transaction_if_safe is false or keeping it is deemed
   // unsafe. If the fetch cache is enabled it should be already open (and this
   // function never closes it), unless in the simulation mode. Return the
   // selected package object which may replace the existing one.
   //
+  // If the archive prefetcher is specified, then take the package archive
+  // from it, if present, rather than downloading it.
+  //
   // Note that both package and repository information configurations need to
   // be passed.
   //
@@ -63,7 +169,8 @@ namespace bpkg
              version,
              bool replace,
              bool simulate,
-             bool keep_transaction_if_safe);
+             bool keep_transaction_if_safe,
+             archive_prefetcher* = nullptr);
 
   pkg_fetch_options
   merge_options (const default_options<pkg_fetch_options>&,
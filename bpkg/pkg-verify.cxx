@@ -3,6 +3,7 @@
 
 #include <bpkg/pkg-verify.hxx>
 
+#include <sstream>
 #include <iostream> // cout
 
 #include <libbutl/manifest-parser.hxx>
@@ -173,6 +174,37 @@ namespace bpkg
     dir_path pd (package_dir (af));
     path mf (pd / manifest_file);
 
+    // Extracting the manifest, the file-referencing values, and the
+    // buildfiles as well as listing the archive contents with tar would
+    // decompress the archive multiple times. So first try to read everything
+    // we may need in a single pass (see read_archive() for details). Limit
+    // the files we keep in memory to the manifest, those which can be
+    // referenced by the manifest values, and to the build system
+    // directories, provided they are not unreasonably large. Any other
+    // file, if required, will still be extracted with tar.
+    //
+    optional<archive_entries> ae;
+    {
+      dir_path sd (pd / std_build_dir);
+      dir_path ad (pd / alt_build_dir);
+
+      ae = read_archive (
+        co,
+        af,
+        [ev, lb, &pd, &mf, &sd, &ad] (const path& f, uint64_t n)
+        {
+          return n <= 1024 * 1024 &&
+                 (f == mf                          ||
+                  (ev && f.directory () == pd)     ||
+                  (lb && (f.sub (sd) || f.sub (ad))));
+        });
+
+      // Let tar diagnose the missing manifest.
+      //
+      if (ae && ae->files.find (mf) == ae->files.end ())
+        ae = nullopt;
+    }
+
     // If the diag level is less than 2, we need to make tar not print any
     // diagnostics. There doesn't seem to be an option to suppress this and
     // the only way is to redirect stderr to something like /dev/null.
@@ -182,21 +214,48 @@ namespace bpkg
     // that the child error is always the reason for the manifest parsing
     // failure.
     //
-    pair<process, process> pr (start_extract (co, af, mf, diag_level == 2));
+    pair<process, process> pr (
+      !ae
+      ? start_extract (co, af, mf, diag_level == 2)
+      : make_pair (process (process_exit (0)), process (process_exit (0))));
 
     auto wait = [&pr] () {return pr.second.wait () && pr.first.wait ();};
 
+    // Return the file content, extracting it with tar if it was not read
+    // from the archive in-process.
+    //
+    auto extract_file = [&ae, &co, &af, diag_level] (const path& f)
+    {
+      if (ae)
+      {
+        auto i (ae->files.find (f));
+        if (i != ae->files.end ())
+          return i->second;
+      }
+
+      return extract (co, af, f, diag_level != 0);
+    };
+
     try
     {
-      ifdstream is (move (pr.second.in_ofd), fdstream_mode::skip);
-      manifest_parser mp (is, mf.string ());
+      ifdstream ifs;
+      istringstream iss;
+
+      if (!ae)
+        ifs.open (move (pr.second.in_ofd), fdstream_mode::skip);
+      else
+        iss.str (ae->files[mf]);
+
+      manifest_parser mp (!ae ? static_cast<istream&> (ifs) : iss,
+                          mf.string ());
 
       package_manifest m (mp.name (),
                           pkg_verify (co, mp, it, af, diag_level),
                           iu,
                           cv);
 
-      is.close ();
+      if (!ae)
+        ifs.close ();
 
       if (wait ())
       {
@@ -219,7 +278,7 @@ namespace bpkg
         if (ev || lb)
         {
           m.load_files (
-            [ev, &pd, &co, &af, diag_level]
+            [ev, &pd, &af, diag_level, &extract_file]
             (const string& n, const path& p) -> optional<string>
             {
               bool bf (n == "build-file");
@@ -229,7 +288,7 @@ namespace bpkg
               if (ev || bf)
               {
                 path f (pd / p);
-                string s (extract (co, af, f, diag_level != 0));
+                string s (extract_file (f));
 
                 if (s.empty () && !bf)
                 {
@@ -263,22 +322,24 @@ namespace bpkg
         //
         if (lb)
         {
-          paths ps (archive_contents (co, af, diag_level != 0));
+          paths ps (ae
+                    ? move (ae->contents)
+                    : archive_contents (co, af, diag_level != 0));
 
           auto contains = [&ps] (const path& p)
           {
             return find (ps.begin (), ps.end (), p) != ps.end ();
           };
 
-          auto extract_buildfiles = [&m, &co, &af, &ps, diag_level, &contains]
+          auto extract_buildfiles = [&m, &ps, &contains, &extract_file]
                                     (const path& b,
                                      const path& r,
                                      const dir_path& c,
                                      const string& ext)
           {
-            auto extract_buildfile = [&co, &af, diag_level] (const path& f)
+            auto extract_buildfile = [&extract_file] (const path& f)
             {
-              string r (extract (co, af, f, diag_level != 0));
+              string r (extract_file (f));
               manifest_parser::validate_value_utf8 (r, f.string ());
               return r;
             };
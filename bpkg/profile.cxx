@@ -0,0 +1,121 @@
+// file      : bpkg/profile.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <bpkg/profile.hxx>
+
+#include <libbutl/json/serializer.hxx>
+
+#include <bpkg/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace bpkg
+{
+  resolution_profile* profile (nullptr);
+
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  void resolution_profile::
+  print () const
+  {
+    diag_record dr (text);
+
+    dr << "package dependency resolution profile:";
+
+    for (const phase* p: {&collect_build,
+                          &collect_build_postponed,
+                          &order,
+                          &execute_plan})
+    {
+      dr << "\n  " << p->name << ": "
+         << duration_cast<microseconds> (p->time).count () / 1000.0
+         << "ms in " << p->calls << " calls";
+    }
+
+    dr << "\n  refinement iterations: "     << refinements
+       << "\n  scratch collections: "       << scratch_collections
+       << "\n  snapshot restores: "         << snapshot_restores
+       << "\n  skeleton bootstraps: "       << skeleton_bootstraps
+       << "\n  available package queries: " << available_queries
+       << "\n  dependent package queries: " << dependent_queries;
+  }
+
+  void resolution_profile::
+  write (const path& f) const
+  {
+    try
+    {
+      ofdstream os (f);
+      json::stream_serializer s (os);
+
+      s.begin_object ();
+
+      s.member_name ("phases", false /* check */);
+      s.begin_object ();
+
+      for (const phase* p: {&collect_build,
+                            &collect_build_postponed,
+                            &order,
+                            &execute_plan})
+      {
+        s.member_name (p->name, false /* check */);
+        s.begin_object ();
+        s.member ("time_us",
+                  static_cast<uint64_t> (
+                    duration_cast<microseconds> (p->time).count ()));
+        s.member ("calls", static_cast<uint64_t> (p->calls));
+        s.end_object ();
+      }
+
+      s.end_object ();
+
+      // Note that the counters are size_t, which may not match any of the
+      // serializer's integer overloads exactly on some platforms.
+      //
+      auto counter = [&s] (const char* n, size_t v)
+      {
+        s.member (n, static_cast<uint64_t> (v));
+      };
+
+      counter ("refinements",         refinements);
+      counter ("scratch_collections", scratch_collections);
+      counter ("snapshot_restores",   snapshot_restores);
+      counter ("skeleton_bootstraps", skeleton_bootstraps);
+      counter ("available_queries",   available_queries);
+      counter ("dependent_queries",   dependent_queries);
+
+      s.end_object ();
+
+      os << '\n';
+      os.close ();
+    }
+    catch (const io_error& e)
+    {
+      // Let's not fail the command itself.
+      //
+      warn << "unable to write to " << f << ": " << e;
+    }
+  }
+
+  profile_phase::
+  profile_phase (resolution_profile::phase resolution_profile::* p)
+      : phase_ (profile != nullptr ? &(profile->*p) : nullptr)
+  {
+    if (phase_ != nullptr)
+    {
+      ++phase_->calls;
+
+      if (phase_->depth++ == 0)
+        phase_->start = resolution_profile::clock::now ();
+    }
+  }
+
+  profile_phase::
+  ~profile_phase ()
+  {
+    if (phase_ != nullptr && --phase_->depth == 0)
+      phase_->time += resolution_profile::clock::now () - phase_->start;
+  }
+}
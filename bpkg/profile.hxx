@@ -0,0 +1,86 @@
+// file      : bpkg/profile.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef BPKG_PROFILE_HXX
+#define BPKG_PROFILE_HXX
+
+#include <chrono>
+
+#include <bpkg/types.hxx>
+#include <bpkg/utility.hxx>
+
+namespace bpkg
+{
+  // Package dependency resolution profile (see pkg-build --profile for
+  // details).
+  //
+  // If installed (see profile below), then the resolution phases record the
+  // time spent in them and the relevant events increment the respective
+  // counters.
+  //
+  struct resolution_profile
+  {
+    using clock = std::chrono::steady_clock;
+
+    // Note that only the outermost invocation of a recursive phase is
+    // timed.
+    //
+    struct phase
+    {
+      const char*       name;
+      clock::duration   time = clock::duration::zero ();
+      size_t            calls = 0;
+
+      size_t            depth = 0; // Current nesting level.
+      clock::time_point start;
+
+      explicit
+      phase (const char* n): name (n) {}
+    };
+
+    phase collect_build           {"collect_build"};
+    phase collect_build_postponed {"collect_build_postponed"};
+    phase order                   {"order"};
+    phase execute_plan            {"execute_plan"};
+
+    size_t refinements         = 0; // Plan refinement iterations.
+    size_t scratch_collections = 0; // Re-collections from scratch.
+    size_t snapshot_restores   = 0; // Postponed collection snapshot restores.
+    size_t skeleton_bootstraps = 0; // Package skeleton bootstraps.
+    size_t available_queries   = 0; // Available packages database queries.
+    size_t dependent_queries   = 0; // Dependent packages database queries.
+
+    // Print the human-readable summary to stderr.
+    //
+    void
+    print () const;
+
+    // Write the profile in the JSON format into the specified file. Issue
+    // a warning on error.
+    //
+    void
+    write (const path&) const;
+  };
+
+  extern resolution_profile* profile;
+
+  // Record the time spent in the enclosing scope as the specified phase, if
+  // the profile is installed.
+  //
+  class profile_phase
+  {
+  public:
+    explicit
+    profile_phase (resolution_profile::phase resolution_profile::*);
+
+    ~profile_phase ();
+
+    profile_phase (const profile_phase&) = delete;
+    profile_phase& operator= (const profile_phase&) = delete;
+
+  private:
+    resolution_profile::phase* phase_;
+  };
+}
+
+#endif // BPKG_PROFILE_HXX
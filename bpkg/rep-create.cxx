@@ -49,11 +49,16 @@ namespace bpkg
 
   using package_map = map<package_name_version, package_data>;
 
+  // Package manifests from the existing packages.manifest file mapped to
+  // the package archive locations (see --incremental for details).
+  //
+  using existing_map = map<path, package_manifest>;
+
+  // Collect the package archive paths from the repository directory,
+  // recursively.
+  //
   static void
-  collect (const rep_create_options& o,
-           package_map& map,
-           const dir_path& d,
-           const dir_path& root)
+  collect (paths& as, const dir_path& d, const dir_path& root)
   try
   {
     tracer trace ("collect");
@@ -74,7 +79,7 @@ namespace bpkg
       {
       case entry_type::directory:
         {
-          collect (o, map, path_cast<dir_path> (d / p), root);
+          collect (as, path_cast<dir_path> (d / p), root);
           continue;
         }
       case entry_type::regular:
@@ -93,29 +98,87 @@ namespace bpkg
           continue;
       }
 
-      // Verify archive is a package and get its manifest.
-      //
-      path a (d / p);
+      as.push_back (d / p);
+    }
+  }
+  catch (const system_error& e)
+  {
+    fail << "unable to scan directory " << d << ": " << e << endf;
+  }
+
+  // Collect the packages from the repository directory, verifying and
+  // calculating the checksums of their archives in parallel, using up to the
+  // specified number of threads. Reuse the existing package manifests for
+  // the archives whose checksums have not changed.
+  //
+  static void
+  collect (const rep_create_options& o,
+           package_map& map,
+           const dir_path& root,
+           const existing_map& em,
+           size_t jobs)
+  {
+    tracer trace ("collect");
 
-      package_manifest m (
-        pkg_verify (o,
-                    a,
-                    o.ignore_unknown (),
-                    o.ignore_unknown () /* ignore_toolchain */,
-                    true /* expand_values */,
-                    true /* load_buildfiles */));
+    paths as;
+    collect (as, root, root);
 
-      // Calculate its checksum.
-      //
-      m.sha256sum = sha256sum (o, a);
+    l4 ([&]{trace << "verifying " << as.size () << " archives using up to "
+                  << jobs << " threads";});
+
+    vector<package_manifest> ms (as.size ());
+
+    parallel_for (
+      as.size (),
+      jobs,
+      [&o, &as, &ms, &root, &em] (size_t i)
+      {
+        const path& a (as[i]);
+
+        // Package archive location relative to the repository root.
+        //
+        path l (a.leaf (root));
+
+        // Calculate the archive checksum.
+        //
+        string cs (sha256sum (o, a));
+
+        // Reuse the existing package manifest if the archive has not changed
+        // and, otherwise, verify archive is a package and get its manifest.
+        //
+        auto j (em.find (l));
+
+        package_manifest& m (ms[i]);
+
+        if (j != em.end () && *j->second.sha256sum == cs)
+        {
+          m = j->second;
+        }
+        else
+        {
+          m = pkg_verify (o,
+                          a,
+                          o.ignore_unknown (),
+                          o.ignore_unknown () /* ignore_toolchain */,
+                          true /* expand_values */,
+                          true /* load_buildfiles */);
+        }
+
+        m.sha256sum = move (cs);
+        m.location = move (l);
+      });
+
+    // Add the packages to the map in the directory scan order, so that the
+    // duplicates are diagnosed deterministically.
+    //
+    for (size_t i (0); i != as.size (); ++i)
+    {
+      const path& a (as[i]);
+      package_manifest& m (ms[i]);
 
       l4 ([&]{trace << m.name << " " << m.version << " in " << a
                     << " sha256sum " << *m.sha256sum;});
 
-      // Add package archive location relative to the repository root.
-      //
-      m.location = a.leaf (root);
-
       package_name_version k {m.name, m.version}; // Argument evaluation order.
       auto r (map.emplace (move (k), package_data {a, move (m)}));
 
@@ -136,10 +199,6 @@ namespace bpkg
       }
     }
   }
-  catch (const system_error& e)
-  {
-    fail << "unable to scan directory " << d << ": " << e << endf;
-  }
 
   int
   rep_create (const rep_create_options& o, cli::scanner& args)
@@ -180,8 +239,37 @@ namespace bpkg
     // packages will be pretty much random and not reproducible. By
     // collecting all the manifests in a map we get a sorted list.
     //
+    // Note that the package archives are verified in parallel (see --jobs
+    // for details).
+    //
+    size_t jobs (parallel_jobs (o));
+
+    // If requested, load the existing packages manifest to reuse the package
+    // manifests for the unchanged archives.
+    //
+    existing_map em;
+
+    if (o.incremental ())
+    {
+      path f (d / packages_file);
+
+      if (exists (f))
+      {
+        for (package_manifest& m: pkg_fetch_packages (f, o.ignore_unknown ()))
+        {
+          assert (m.location && m.sha256sum);
+
+          path l (*m.location);
+          em.emplace (move (l), move (m));
+        }
+      }
+
+      l4 ([&]{trace << "loaded " << em.size () << " existing package "
+                    << "manifests";});
+    }
+
     package_map pm;
-    collect (o, pm, d, d);
+    collect (o, pm, d, em, jobs);
 
     pkg_package_manifests manifests;
     manifests.sha256sum = sha256sum (o, path (d / repositories_file));
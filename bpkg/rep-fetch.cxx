@@ -44,6 +44,14 @@ namespace bpkg
   //
   static bool filesystem_state_changed;
 
+  // Names of the repository fragments whose available packages may have been
+  // partially removed during the full fetch before these fragments are
+  // (re-)fetched (see rep_fragment() for details). Such fragments must be
+  // repopulated from scratch even if unchanged. Must be cleared by the
+  // rep_fetch_*() caller, similar to filesystem_state_changed.
+  //
+  static set<string> outdated_fragments;
+
   inline static bool
   need_auth (const common_options& co, const repository_location& rl)
   {
@@ -51,6 +59,27 @@ namespace bpkg
       (co.auth () == auth::all || rl.remote ());
   }
 
+  // Metadata of the remote pkg repositories downloaded ahead of time (see
+  // prefetch_pkg_metadata() for details) keyed by the repository URL. An
+  // entry is removed when picked up by rep_fetch_pkg().
+  //
+  struct pkg_prefetch
+  {
+    using repositories_type = pair<pkg_repository_manifests, string>;
+    using packages_type     = pair<pkg_package_manifests, string>;
+
+    optional<signature_manifest> signature;
+    optional<repositories_type>  repositories; // Manifests and checksum.
+    optional<packages_type>      packages;     // Manifests and checksum.
+
+    // True if the download failed, in which case the diagnostics has already
+    // been issued.
+    //
+    bool error = false;
+  };
+
+  static map<string, pkg_prefetch> pkg_prefetches;
+
   static rep_fetch_data
   rep_fetch_pkg (const common_options& co,
                  const dir_path* conf,
@@ -119,6 +148,80 @@ namespace bpkg
            << " in offline mode with fetch cache disabled" <<
         info << "consider enabling fetch cache or turning offline mode off";
 
+    // Pick up the metadata downloaded ahead of time, if any.
+    //
+    optional<pkg_prefetch> pf;
+    {
+      auto i (pkg_prefetches.find (rl.url ().string ()));
+
+      if (i != pkg_prefetches.end ())
+      {
+        // Note that the diagnostics has already been issued.
+        //
+        if (i->second.error)
+          throw failed ();
+
+        pf = move (i->second);
+        pkg_prefetches.erase (i);
+      }
+    }
+
+    // Fetch the manifests, unless they are already downloaded, running the
+    // cache garbage collection during the downloads.
+    //
+    auto fetch_signature = [&co, &rl, &cache, &pf] ()
+    {
+      if (pf && pf->signature)
+      {
+        signature_manifest r (move (*pf->signature));
+        pf->signature = nullopt;
+        return r;
+      }
+
+      if (cache.enabled ()) cache.start_gc ();
+      signature_manifest r (
+        pkg_fetch_signature (co, rl, true /* ignore_unknown */));
+      if (cache.enabled ()) cache.stop_gc ();
+
+      return r;
+    };
+
+    auto fetch_repositories = [&co, &rl, ignore_unknown, &cache, &pf] ()
+    {
+      using result = pair<pkg_repository_manifests, string /* checksum */>;
+
+      if (pf && pf->repositories)
+      {
+        result r (move (*pf->repositories));
+        pf->repositories = nullopt;
+        return r;
+      }
+
+      if (cache.enabled ()) cache.start_gc ();
+      result r (pkg_fetch_repositories (co, rl, ignore_unknown));
+      if (cache.enabled ()) cache.stop_gc ();
+
+      return r;
+    };
+
+    auto fetch_packages = [&co, conf, &rl, ignore_unknown, &cache, &pf] ()
+    {
+      using result = pair<pkg_package_manifests, string /* checksum */>;
+
+      if (pf && pf->packages)
+      {
+        result r (move (*pf->packages));
+        pf->packages = nullopt;
+        return r;
+      }
+
+      if (cache.enabled ()) cache.start_gc ();
+      result r (pkg_fetch_packages (co, conf, rl, ignore_unknown));
+      if (cache.enabled ()) cache.stop_gc ();
+
+      return r;
+    };
+
     // If the cached metadata is retrieved, determine which of the cached
     // metadata files we can use. Specifically:
     //
@@ -143,6 +246,7 @@ namespace bpkg
     //
     path cached_repositories_path;
     path cached_packages_path;
+    path cached_packages_binary_path;
 
     // While at it, stash all the fetched manifests for potential reuse.
     //
@@ -155,6 +259,7 @@ namespace bpkg
       {
         cached_repositories_path = move (crm->repositories_path);
         cached_packages_path = move (crm->packages_path);
+        cached_packages_binary_path = move (crm->packages_binary_path);
 
         // Valid cache.
         //
@@ -176,20 +281,17 @@ namespace bpkg
         //
         assert (!cache.offline ());
 
-        cache.start_gc ();
-        sm = pkg_fetch_signature (co, rl, true /* ignore_unknown */);
-        cache.stop_gc ();
+        sm = fetch_signature ();
 
         if (sm->sha256sum == crm->packages_checksum)
         {
           cached_repositories_path = move (crm->repositories_path);
           cached_packages_path = move (crm->packages_path);
+          cached_packages_binary_path = move (crm->packages_binary_path);
         }
         else
         {
-          cache.start_gc ();
-          pmc = pkg_fetch_packages (co, conf, rl, ignore_unknown);
-          cache.stop_gc ();
+          pmc = fetch_packages ();
 
           if (sm->sha256sum != pmc->second)
           {
@@ -234,9 +336,7 @@ namespace bpkg
       //
       assert (!cache.offline ());
 
-      if (cache.enabled ()) cache.start_gc ();
-      rmc = pkg_fetch_repositories (co, rl, ignore_unknown);
-      if (cache.enabled ()) cache.stop_gc ();
+      rmc = fetch_repositories ();
 
       fr.repositories = move (rmc->first);
     }
@@ -306,9 +406,7 @@ namespace bpkg
         //
         assert (!cache.offline ());
 
-        if (cache.enabled ()) cache.start_gc ();
-        pmc = pkg_fetch_packages (co, conf, rl, ignore_unknown);
-        if (cache.enabled ()) cache.stop_gc ();
+        pmc = fetch_packages ();
 
         if (rmc->second != pmc->first.sha256sum)
         {
@@ -324,10 +422,36 @@ namespace bpkg
       }
 
       fr.packages = move (pmc->first);
+      fr.packages_checksum = pmc->second;
     }
     else
     {
-      fr.packages = pkg_fetch_packages (cached_packages_path, ignore_unknown);
+      // Load the cached packages manifest from its binary form, if present
+      // and up-to-date, which is much faster than parsing the manifest file.
+      // Otherwise, parse the manifest file and (re-)create its binary form
+      // for the subsequent loads.
+      //
+      optional<pkg_package_manifests> pms (
+        pkg_load_packages (cached_packages_binary_path,
+                           cached_packages_path,
+                           ignore_unknown));
+
+      if (pms)
+      {
+        l4 ([&]{trace << "loaded binary packages manifest "
+                      << cached_packages_binary_path;});
+
+        fr.packages = move (*pms);
+      }
+      else
+      {
+        fr.packages = pkg_fetch_packages (cached_packages_path,
+                                          ignore_unknown);
+
+        pkg_save_packages (cached_packages_path, cached_packages_binary_path);
+      }
+
+      fr.packages_checksum = move (crm->cached_packages_checksum);
     }
 
     // Authenticate the repository.
@@ -344,9 +468,7 @@ namespace bpkg
         //
         assert (!cache.offline ());
 
-        if (cache.enabled ()) cache.start_gc ();
-        sm = pkg_fetch_signature (co, rl, true /* ignore_unknown */);
-        if (cache.enabled ()) cache.stop_gc ();
+        sm = fetch_signature ();
       }
 
       assert (pmc); // Wouldn't be here otherwise.
@@ -461,6 +583,8 @@ namespace bpkg
 
           mv (p, srm.packages_path);
           arm.cancel ();
+
+          pkg_save_packages (srm.packages_path, srm.packages_binary_path);
         }
       }
 
@@ -1708,11 +1832,30 @@ namespace bpkg
       }
     }
 
+    // If the packages metadata of an existing fragment is not changed since
+    // the fragment has been populated, then leave its available packages
+    // intact. For a large repository this saves us recreating tens of
+    // thousands of the database objects on a no-op fetch.
+    //
+    bool unchanged (exists                                          &&
+                    fr.packages_checksum                            &&
+                    rf->packages_checksum == fr.packages_checksum   &&
+                    outdated_fragments.find (rf->name) ==
+                    outdated_fragments.end ());
+
+    rf->packages_checksum = move (fr.packages_checksum);
+
     if (exists)
       db.update (rf);
     else
       db.persist (rf);
 
+    if (unchanged)
+    {
+      l4 ([&]{trace << "packages of " << rf->name << " are unchanged";});
+      return rf;
+    }
+
     // "Suspend" session while persisting packages to reduce memory
     // consumption.
     //
@@ -1720,11 +1863,9 @@ namespace bpkg
     session::reset_current ();
 
     // Remove this repository fragment from locations of the available
-    // packages it contains. Note that when we fetch all the repositories the
-    // available packages are cleaned up in advance (see rep_fetch() for
-    // details).
+    // packages it contains.
     //
-    if (exists && !full_fetch)
+    if (exists)
       rep_remove_package_locations (db, t, rf->name);
 
     vector<package_manifest>&   pms (fr.packages);
@@ -1776,9 +1917,42 @@ namespace bpkg
         //
         assert (!p->locations.empty ()); // Can't be transient.
 
+        // If we fetch all the repositories, then the package may also come
+        // from the fragments which are not (re-)fetched yet and so may be
+        // outdated, since the available packages are not cleaned up in
+        // advance (see rep_fetch() for details). If the checksum mismatch is
+        // caused by such fragments only, then replace the package and make
+        // sure that these fragments are repopulated from scratch when
+        // fetched.
+        //
+        if (full_fetch                     &&
+            pm.sha256sum && p->sha256sum   &&
+            *pm.sha256sum != *p->sha256sum &&
+            none_of (p->locations.begin (), p->locations.end (),
+                     [&parsed_fragments] (const package_location& l)
+                     {
+                       const string& n (l.repository_fragment.object_id ());
+
+                       return find_if (
+                         parsed_fragments.begin (),
+                         parsed_fragments.end (),
+                         [&n] (const shared_ptr<repository_fragment>& f)
+                         {
+                           return f->name == n;
+                         }) != parsed_fragments.end ();
+                     }))
+        {
+          for (const package_location& l: p->locations)
+            outdated_fragments.insert (l.repository_fragment.object_id ());
+
+          db.erase (p);
+
+          p = make_shared<available_package> (move (pm));
+          persist = true;
+        }
         // Note that sha256sum may not present for some repository types.
         //
-        if (pm.sha256sum)
+        else if (pm.sha256sum)
         {
           if (!p->sha256sum)
             p->sha256sum = move (pm.sha256sum);
@@ -1829,6 +2003,170 @@ namespace bpkg
 
   using repositories = set<shared_ptr<repository>>;
 
+  // If requested (--fetch-jobs), download in parallel the metadata of the
+  // remote pkg repositories which are about to be fetched, for it to be
+  // subsequently picked up by rep_fetch_pkg().
+  //
+  // Note that we only download what rep_fetch_pkg() is going to need,
+  // assessing the fetch cache state without changing it (see
+  // fetch_cache::peek_pkg_repository_metadata() for details). Also note that
+  // rep_fetch_pkg() downloads whatever is still missing itself, so the cache
+  // state change in between is not an issue.
+  //
+  static void
+  prefetch_pkg_metadata (const common_options& co,
+                         database& db,
+                         const vector<shared_ptr<repository>>& rs)
+  {
+    tracer trace ("prefetch_pkg_metadata");
+
+    size_t jobs (parallel_jobs (co.fetch_jobs ()));
+
+    if (jobs < 2 || rs.size () < 2 || fetch_cache::offline (co))
+      return;
+
+    struct item
+    {
+      reference_wrapper<const repository_location> location;
+
+      // Absent if there is no cache entry (or the cache is disabled) and
+      // contains the checksums if the cached metadata needs to be validated.
+      //
+      optional<fetch_cache::loaded_pkg_repository_metadata> cached;
+
+      pkg_prefetch result;
+    };
+
+    vector<item> items;
+
+    for (const shared_ptr<repository>& r: rs)
+    {
+      const repository_location& rl (r->location);
+
+      if (rl.type () == repository_type::pkg &&
+          rl.remote ()                       &&
+          pkg_prefetches.find (rl.url ().string ()) == pkg_prefetches.end ())
+      {
+        items.push_back (item {rl, nullopt, pkg_prefetch ()});
+      }
+    }
+
+    if (items.size () < 2)
+      return;
+
+    {
+      fetch_cache cache (co, &db);
+
+      if (cache.enabled ())
+      {
+        cache.open (trace);
+
+        for (item& i: items)
+        {
+          const repository_location& rl (i.location);
+          i.cached = cache.peek_pkg_repository_metadata (rl.url ());
+        }
+
+        cache.close ();
+
+        // Skip the repositories whose cached metadata can be used without
+        // validation (session).
+        //
+        items.erase (remove_if (items.begin (), items.end (),
+                                [] (const item& i)
+                                {
+                                  return i.cached &&
+                                         i.cached->packages_checksum.empty ();
+                                }),
+                     items.end ());
+
+        if (items.size () < 2)
+          return;
+      }
+    }
+
+    l4 ([&]{trace << "downloading metadata for " << items.size ()
+                  << " repositories using " << jobs << " threads";});
+
+    // Suppress the progress indication for the concurrent downloads.
+    //
+    common_options qo (co);
+    qo.progress (false);
+    qo.no_progress (true);
+
+    const dir_path* conf (&db.config_orig);
+
+    parallel_for (
+      items.size (),
+      jobs,
+      [&qo, conf, &items] (size_t i)
+      {
+        item& it (items[i]);
+
+        const repository_location& rl (it.location);
+        const auto& cm (it.cached);
+        pkg_prefetch& r (it.result);
+
+        // Note that the serial fetch ignores unknown manifest values (see
+        // rep_fetch() for details).
+        //
+        try
+        {
+          if (cm)
+          {
+            // Fetch the signature manifest and, if the packages manifest
+            // checksum doesn't match, the packages manifest and, if the
+            // repositories manifest checksum doesn't match either, the
+            // repositories manifest.
+            //
+            r.signature = pkg_fetch_signature (qo,
+                                               rl,
+                                               true /* ignore_unknown */);
+
+            if (r.signature->sha256sum != cm->packages_checksum)
+            {
+              r.packages = pkg_fetch_packages (qo,
+                                               conf,
+                                               rl,
+                                               true /* ignore_unknown */);
+
+              if (r.packages->first.sha256sum != cm->repositories_checksum)
+                r.repositories = pkg_fetch_repositories (
+                  qo, rl, true /* ignore_unknown */);
+            }
+          }
+          else
+          {
+            // Fetch the repositories and packages manifests and, if the
+            // repository is signed and needs to be authenticated, the
+            // signature manifest.
+            //
+            r.repositories = pkg_fetch_repositories (
+              qo, rl, true /* ignore_unknown */);
+
+            r.packages = pkg_fetch_packages (qo,
+                                             conf,
+                                             rl,
+                                             true /* ignore_unknown */);
+
+            if (need_auth (qo, rl) &&
+                find_base_repository (r.repositories->first).certificate)
+              r.signature = pkg_fetch_signature (qo,
+                                                 rl,
+                                                 true /* ignore_unknown */);
+          }
+        }
+        catch (const failed&)
+        {
+          r.error = true;
+        }
+      });
+
+    for (item& i: items)
+      pkg_prefetches.emplace (i.location.get ().url ().string (),
+                              move (i.result));
+  }
+
   static void
   rep_fetch (const common_options& co,
              database& db,
@@ -2061,6 +2399,31 @@ namespace bpkg
                    false /* no_dir_progress */);
       };
 
+      // Download the metadata of the complements and prerequisites ahead of
+      // time, if requested.
+      //
+      {
+        vector<shared_ptr<repository>> rs;
+
+        auto add = [&fetched_repositories, &rs] (shared_ptr<repository>&& r)
+        {
+          if (fetched_repositories.find (r) == fetched_repositories.end () &&
+              find (rs.begin (), rs.end (), r) == rs.end ())
+            rs.push_back (move (r));
+        };
+
+        for (const auto& cr: new_complements)
+        {
+          if (cr.object_id () != "")
+            add (cr.load ());
+        }
+
+        for (const auto& pr: new_prerequisites)
+          add (pr.load ());
+
+        prefetch_pkg_metadata (co, db, rs);
+      }
+
       // Fetch complements and prerequisites.
       //
       for (const auto& cr: new_complements)
@@ -2110,12 +2473,31 @@ namespace bpkg
       // measures (see below).
       //
       filesystem_state_changed = false;
+      outdated_fragments.clear ();
 
       repositories         fetched_repositories;
       repositories         removed_repositories;
       repository_fragments parsed_fragments;
       repository_fragments removed_fragments;
 
+      // Drop the metadata downloaded ahead of time but not picked up (due to
+      // an error, etc).
+      //
+      auto pg (make_guard ([] () {pkg_prefetches.clear ();}));
+
+      // Download the metadata of the requested repositories ahead of time, if
+      // requested.
+      //
+      {
+        vector<shared_ptr<repository>> rs;
+        rs.reserve (repos.size ());
+
+        for (const lazy_shared_ptr<repository>& r: repos)
+          rs.push_back (r.load ());
+
+        prefetch_pkg_metadata (o, db, rs);
+      }
+
       // Fetch the requested repositories, recursively.
       //
       for (const lazy_shared_ptr<repository>& r: repos)
@@ -2226,29 +2608,25 @@ namespace bpkg
       // the test packages special test dependencies.
       //
       // But first, remove the existing (and possibly outdated) special test
-      // dependencies from the test packages, unless all the available
-      // packages are (re)created from scratch.
+      // dependencies from the test packages.
       //
-      if (!full_fetch)
+      for (const auto& at: db.query<available_test> ())
       {
-        for (const auto& at: db.query<available_test> ())
-        {
-          dependencies& ds (at.package->dependencies);
+        dependencies& ds (at.package->dependencies);
 
-          // Note that there is only one special test dependencies entry in
-          // the test package.
-          //
-          for (auto i (ds.begin ()), e (ds.end ()); i != e; ++i)
+        // Note that there is only one special test dependencies entry in the
+        // test package.
+        //
+        for (auto i (ds.begin ()), e (ds.end ()); i != e; ++i)
+        {
+          if (to_test_dependency_type (i->type))
           {
-            if (to_test_dependency_type (i->type))
-            {
-              ds.erase (i);
-              break;
-            }
+            ds.erase (i);
+            break;
           }
-
-          db.update (at.package);
         }
+
+        db.update (at.package);
       }
 
       // Go through the available packages that have external tests and add
@@ -2551,11 +2929,11 @@ namespace bpkg
       for (const lazy_weak_ptr<repository>& r: ua)
         repos.push_back (lazy_shared_ptr<repository> (r));
 
-      // Cleanup the available packages in advance to avoid sha256sum mismatch
-      // for packages being fetched and the old available packages, that are
-      // not wiped out yet (see rep_fragment() for details).
-      //
-      db.erase_query<available_package> ();
+      // Note that we don't cleanup the available packages in advance, so
+      // that the packages of the unchanged repository fragments can be left
+      // intact. Instead, the sha256sum mismatch for packages being fetched
+      // and the old available packages, that are not wiped out yet, is
+      // handled by rep_fragment() (see it for details).
     }
     else
     {
@@ -42,6 +42,11 @@ namespace bpkg
       // satisfactory for all the repository packages.
       //
       vector<package_info>        package_infos;
+
+      // The packages manifest file checksum for pkg repositories and nullopt
+      // for other repository types.
+      //
+      optional<string>            packages_checksum;
     };
 
     vector<fragment> fragments;
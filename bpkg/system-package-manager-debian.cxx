@@ -219,6 +219,11 @@ namespace bpkg
   //
   // If the n argument is not 0, then only query the first n packages.
   //
+  // If all the packages have been prefetched (see status_prefetch()) or
+  // their versions have been cached by the previous runs for the current
+  // state of the system package database (see enable_query_cache()), then
+  // return the cached versions instead.
+  //
   void system_package_manager_debian::
   apt_cache_policy (vector<package_policy>& pps, size_t n)
   {
@@ -227,6 +232,58 @@ namespace bpkg
 
     assert (n != 0 && n <= pps.size ());
 
+    if (!policy_cache_.empty () &&
+        all_of (pps.begin (), pps.begin () + n,
+                [this] (const package_policy& pp)
+                {
+                  return policy_cache_.find (pp.name) != policy_cache_.end ();
+                }))
+    {
+      for (size_t i (0); i != n; ++i)
+      {
+        package_policy& pp (pps[i]);
+        const package_policy& cp (policy_cache_.find (pp.name)->second);
+
+        pp.installed_version = cp.installed_version;
+        pp.candidate_version = cp.candidate_version;
+      }
+
+      return;
+    }
+
+    // Each result in the persistent cache has the '<installed> <candidate>'
+    // form.
+    //
+    optional<string> stamp;
+    if (query_cache_ && (stamp = query_cache_->stamp ()))
+    {
+      vector<const string*> rs;
+      for (size_t i (0); i != n; ++i)
+      {
+        const string* r (query_cache_->find (*stamp, pps[i].name));
+
+        if (r == nullptr || r->find (' ') == string::npos)
+          break;
+
+        rs.push_back (r);
+      }
+
+      if (rs.size () == n)
+      {
+        for (size_t i (0); i != n; ++i)
+        {
+          package_policy& pp (pps[i]);
+          const string& r (*rs[i]);
+
+          size_t p (r.find (' '));
+          pp.installed_version.assign (r, 0, p);
+          pp.candidate_version.assign (r, p + 1, string::npos);
+        }
+
+        return;
+      }
+    }
+
     // The --quiet option makes sure we don't get a noice (N) printed to
     // stderr if the package is unknown. It does not appear to affect error
     // diagnostics (try temporarily renaming /var/lib/dpkg/status).
@@ -447,6 +504,19 @@ namespace bpkg
 
       throw failed ();
     }
+
+    if (stamp)
+    {
+      vector<pair<string, string>> rs;
+      for (size_t i (0); i != n; ++i)
+      {
+        const package_policy& pp (pps[i]);
+        rs.emplace_back (pp.name,
+                         pp.installed_version + ' ' + pp.candidate_version);
+      }
+
+      query_cache_->insert (*stamp, move (rs));
+    }
   }
 
   // Execute `apt-cache show` and return the Depends value, if any, for the
@@ -460,6 +530,18 @@ namespace bpkg
 
     string spec (name + '=' + ver);
 
+    // Note that the Debian package names cannot contain '=' and so the
+    // specification can be used as a key in the persistent cache (see
+    // apt_cache_policy() for background) without clashing with the package
+    // names.
+    //
+    optional<string> stamp;
+    if (query_cache_ && (stamp = query_cache_->stamp ()))
+    {
+      if (const string* r = query_cache_->find (*stamp, spec))
+        return *r;
+    }
+
     // In particular, --quiet makes sure we don't get noices (N) printed to
     // stderr. It does not appear to affect error diagnostics (try showing
     // information for an unknown package).
@@ -670,6 +752,9 @@ namespace bpkg
       throw failed ();
     }
 
+    if (stamp)
+      query_cache_->insert (*stamp, {make_pair (move (spec), r)});
+
     return r;
   }
 
@@ -910,6 +995,199 @@ namespace bpkg
     }
   }
 
+  // Translate the bpkg package name to the Debian package names and return
+  // the resulting list of candidate packages, which is never empty.
+  //
+  auto system_package_manager_debian::
+  status_candidates (const package_name& pn,
+                     const available_packages& aps,
+                     bool need_doc,
+                     bool need_dbg) const -> vector<package_status>
+  {
+    vector<package_status> candidates;
+
+    auto df = make_diag_frame (
+      [this, &pn] (diag_record& dr)
+      {
+        dr << info << "while mapping " << pn << " to "
+           << os_release.name_id << " package name";
+      });
+
+    // Without explicit type, the best we can do in trying to detect whether
+    // this is a library is to check for the lib prefix. Libraries without
+    // the lib prefix and non-libraries with the lib prefix (both of which
+    // we do not recomment) will have to provide a manual mapping (or
+    // explicit type).
+    //
+    // Note that using the first (latest) available package as a source of
+    // type information seems like a reasonable choice.
+    //
+    const string& pt (!aps.empty ()
+                      ? aps.front ().first->effective_type ()
+                      : package_manifest::effective_type (nullopt, pn));
+
+    strings ns;
+    if (!aps.empty ())
+      ns = system_package_names (aps,
+                                 os_release.name_id,
+                                 os_release.version_id,
+                                 os_release.like_ids,
+                                 true /* native */);
+    if (ns.empty ())
+    {
+      // Attempt to automatically translate our package name (see above for
+      // details).
+      //
+      const string& n (pn.string ());
+
+      if (pt == "lib")
+      {
+        // Keep the main package name empty as an indication that it is to
+        // be discovered.
+        //
+        // @@ It seems that quite often the header-only library -dev package
+        //    name doesn't start with 'lib'. Here are some randomly chosen
+        //    packages: libeigen3-dev, libmdds-dev, rapidjson-dev, etl-dev,
+        //    seqan-dev, catch2. Should we implement the fallback similar to
+        //    the Fedora implementation? Maybe one day.
+        //
+        candidates.push_back (package_status ("", n + "-dev"));
+      }
+      else
+        candidates.push_back (package_status (n));
+    }
+    else
+    {
+      // Parse each manual mapping.
+      //
+      for (const string& n: ns)
+      {
+        package_status s (parse_name_value (pt, n, need_doc, need_dbg));
+
+        // Suppress duplicates for good measure based on the main package
+        // name (and falling back to -dev if empty).
+        //
+        auto i (find_if (candidates.begin (), candidates.end (),
+                         [&s] (const package_status& x)
+                         {
+                           // Note that it's possible for one mapping to be
+                           // specified as -dev only while the other as main
+                           // and -dev.
+                           //
+                           return s.main.empty () || x.main.empty ()
+                             ? s.dev == x.dev
+                             : s.main == x.main;
+                         }));
+        if (i == candidates.end ())
+          candidates.push_back (move (s));
+        else
+        {
+          // Should we verify the rest matches for good measure? But what if
+          // we need to override, as in:
+          //
+          // debian_10-name: libcurl4 libcurl4-openssl-dev
+          // debian_9-name: libcurl4 libcurl4-dev
+          //
+          // Note that for this to work we must get debian_10 values before
+          // debian_9, which is the semantics guaranteed by
+          // system_package_names().
+        }
+      }
+    }
+
+    return candidates;
+  }
+
+  // Add the package components to query the policies for to the candidate
+  // package policy list.
+  //
+  static void
+  add_package_policies (package_status& ps, bool need_doc, bool need_dbg)
+  {
+    vector<package_status::package_policy>& pps (ps.package_policies);
+
+    if (!ps.main.empty ())            pps.emplace_back (ps.main);
+    if (!ps.dev.empty ())             pps.emplace_back (ps.dev);
+    if (!ps.doc.empty () && need_doc) pps.emplace_back (ps.doc);
+    if (!ps.dbg.empty () && need_dbg) pps.emplace_back (ps.dbg);
+    if (!ps.common.empty () && false) pps.emplace_back (ps.common);
+    ps.package_policies_main = pps.size ();
+    for (const string& n: ps.extras)  pps.emplace_back (n);
+  }
+
+  void system_package_manager_debian::
+  enable_query_cache (const dir_path& d)
+  {
+    // The installed versions are recorded in the dpkg status file while the
+    // candidate versions are determined by the repositories metadata
+    // (updated by apt-get update) and the APT preferences (pinning).
+    //
+    query_cache_ = system_package_query_cache (
+      d / path ("debian-apt-cache-policy.txt"),
+      (simulate_ != nullptr
+       ? simulate_->query_cache_entries_
+       : paths {path ("/var/lib/dpkg/status"),
+                dir_path ("/var/lib/apt/lists"),
+                path ("/etc/apt/preferences"),
+                dir_path ("/etc/apt/preferences.d")}),
+      os_release.name_id + '_' + os_release.version_id + ' ' + arch);
+  }
+
+  void system_package_manager_debian::
+  status_prefetch (const vector<pair<package_name, available_packages>>& ps)
+  {
+    // Note: should be consistent with status() below.
+    //
+    bool need_doc (false);
+    bool need_dbg (false);
+
+    // Collect the components of all the candidate packages for all the
+    // not yet cached bpkg packages, suppressing duplicates, and query them
+    // with a single apt-cache invocation.
+    //
+    // Note that the main packages which are yet to be discovered (see
+    // status() for details) are not covered and are still queried
+    // individually.
+    //
+    vector<package_policy> pps;
+
+    for (const auto& p: ps)
+    {
+      if (status_cache_.find (p.first) != status_cache_.end ())
+        continue;
+
+      for (package_status& c: status_candidates (p.first,
+                                                 p.second,
+                                                 need_doc,
+                                                 need_dbg))
+      {
+        add_package_policies (c, need_doc, need_dbg);
+
+        for (package_policy& pp: c.package_policies)
+        {
+          if (policy_cache_.find (pp.name) == policy_cache_.end () &&
+              find_if (pps.begin (), pps.end (),
+                       [&pp] (const package_policy& x)
+                       {
+                         return x.name == pp.name;
+                       }) == pps.end ())
+            pps.push_back (move (pp));
+        }
+      }
+    }
+
+    if (!pps.empty ())
+    {
+      apt_cache_policy (pps);
+
+      for (package_policy& pp: pps)
+      {
+        string n (pp.name);
+        policy_cache_.emplace (move (n), move (pp));
+      }
+    }
+  }
+
   optional<const system_package_status*> system_package_manager_debian::
   status (const package_name& pn, const available_packages* aps)
   {
@@ -946,100 +1224,8 @@ namespace bpkg
     bool need_doc (false);
     bool need_dbg (false);
 
-    vector<package_status> candidates;
-
-    // Translate our package name to the Debian package names.
-    //
-    {
-      auto df = make_diag_frame (
-        [this, &pn] (diag_record& dr)
-        {
-          dr << info << "while mapping " << pn << " to "
-             << os_release.name_id << " package name";
-        });
-
-      // Without explicit type, the best we can do in trying to detect whether
-      // this is a library is to check for the lib prefix. Libraries without
-      // the lib prefix and non-libraries with the lib prefix (both of which
-      // we do not recomment) will have to provide a manual mapping (or
-      // explicit type).
-      //
-      // Note that using the first (latest) available package as a source of
-      // type information seems like a reasonable choice.
-      //
-      const string& pt (!aps.empty ()
-                        ? aps.front ().first->effective_type ()
-                        : package_manifest::effective_type (nullopt, pn));
-
-      strings ns;
-      if (!aps.empty ())
-        ns = system_package_names (aps,
-                                   os_release.name_id,
-                                   os_release.version_id,
-                                   os_release.like_ids,
-                                   true /* native */);
-      if (ns.empty ())
-      {
-        // Attempt to automatically translate our package name (see above for
-        // details).
-        //
-        const string& n (pn.string ());
-
-        if (pt == "lib")
-        {
-          // Keep the main package name empty as an indication that it is to
-          // be discovered.
-          //
-          // @@ It seems that quite often the header-only library -dev package
-          //    name doesn't start with 'lib'. Here are some randomly chosen
-          //    packages: libeigen3-dev, libmdds-dev, rapidjson-dev, etl-dev,
-          //    seqan-dev, catch2. Should we implement the fallback similar to
-          //    the Fedora implementation? Maybe one day.
-          //
-          candidates.push_back (package_status ("", n + "-dev"));
-        }
-        else
-          candidates.push_back (package_status (n));
-      }
-      else
-      {
-        // Parse each manual mapping.
-        //
-        for (const string& n: ns)
-        {
-          package_status s (parse_name_value (pt, n, need_doc, need_dbg));
-
-          // Suppress duplicates for good measure based on the main package
-          // name (and falling back to -dev if empty).
-          //
-          auto i (find_if (candidates.begin (), candidates.end (),
-                           [&s] (const package_status& x)
-                           {
-                             // Note that it's possible for one mapping to be
-                             // specified as -dev only while the other as main
-                             // and -dev.
-                             //
-                             return s.main.empty () || x.main.empty ()
-                               ? s.dev == x.dev
-                               : s.main == x.main;
-                           }));
-          if (i == candidates.end ())
-            candidates.push_back (move (s));
-          else
-          {
-            // Should we verify the rest matches for good measure? But what if
-            // we need to override, as in:
-            //
-            // debian_10-name: libcurl4 libcurl4-openssl-dev
-            // debian_9-name: libcurl4 libcurl4-dev
-            //
-            // Note that for this to work we must get debian_10 values before
-            // debian_9, which is the semantics guaranteed by
-            // system_package_names().
-          }
-        }
-      }
-    }
+    vector<package_status> candidates (
+      status_candidates (pn, aps, need_doc, need_dbg));
 
     // Guess unknown main package given the -dev package and its version.
     // Failed that, assume the package to be a binless library and leave the
@@ -1106,13 +1292,7 @@ namespace bpkg
       {
         vector<package_policy>& pps (ps.package_policies);
 
-        if (!ps.main.empty ())            pps.emplace_back (ps.main);
-        if (!ps.dev.empty ())             pps.emplace_back (ps.dev);
-        if (!ps.doc.empty () && need_doc) pps.emplace_back (ps.doc);
-        if (!ps.dbg.empty () && need_dbg) pps.emplace_back (ps.dbg);
-        if (!ps.common.empty () && false) pps.emplace_back (ps.common);
-        ps.package_policies_main = pps.size ();
-        for (const string& n: ps.extras)  pps.emplace_back (n);
+        add_package_policies (ps, need_doc, need_dbg);
 
         apt_cache_policy (pps);
 
@@ -1184,6 +1364,26 @@ namespace bpkg
       {
         apt_get_update ();
         fetched_ = true;
+
+        // Since the candidate versions may have changed, re-query the
+        // prefetched packages, if any, with a single apt-cache invocation.
+        //
+        if (!policy_cache_.empty ())
+        {
+          vector<package_policy> pps;
+          for (auto& p: policy_cache_)
+            pps.push_back (move (p.second));
+
+          policy_cache_.clear ();
+
+          apt_cache_policy (pps);
+
+          for (package_policy& pp: pps)
+          {
+            string n (pp.name);
+            policy_cache_.emplace (move (n), move (pp));
+          }
+        }
       }
 
       {
@@ -1419,6 +1619,10 @@ namespace bpkg
     assert (install_ && !installed_);
     installed_ = true;
 
+    // The prefetched policies become stale once we install anything.
+    //
+    policy_cache_.clear ();
+
     // Collect and merge all the Debian packages/versions for the specified
     // bpkg packages.
     //
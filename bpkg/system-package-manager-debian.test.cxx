@@ -38,7 +38,8 @@ namespace bpkg
   //
   //   map-package [<build-metadata>]     manifest comes from stdin
   //
-  //   build <query-pkg>... [--install [--no-fetch] <install-pkg>...]
+  //   build <query-pkg>... [--prefetch]
+  //         [--install [--no-fetch] <install-pkg>...]
   //
   // The stdin of the build command is used to read the simulation description
   // which consists of lines in the following forms (blanks are ignored):
@@ -63,6 +64,11 @@ namespace bpkg
   //
   //   Values for simulation::apt_get_{update,install}_fail_.
   //
+  // query-cache: <dir> <file>
+  //
+  //   Enable the persistent query cache in <dir>, stamping it with <file>
+  //   (see simulation::query_cache_entries_ for details).
+  //
   int
   main (int argc, char* argv[])
   try
@@ -221,8 +227,9 @@ namespace bpkg
         qps.push_back (move (a));
       }
 
-      // Parse --install [--no-fetch]
+      // Parse [--prefetch] --install [--no-fetch]
       //
+      bool prefetch (false);
       bool install (false);
       bool fetch (true);
 
@@ -230,7 +237,8 @@ namespace bpkg
       {
         string a (argv[argi]);
 
-        if (a == "--install") install = true;
+        if (a == "--prefetch") prefetch = true;
+        else if (a == "--install") install = true;
         else if (a == "--no-fetch") fetch = false;
         else break;
       }
@@ -238,6 +246,7 @@ namespace bpkg
       // Parse the description.
       //
       system_package_manager_debian::simulation s;
+      dir_path qc; // Query cache directory.
 
       for (string l; !eof (getline (cin, l)); )
       {
@@ -305,6 +314,15 @@ namespace bpkg
         {
           s.apt_get_install_fail_ = true;
         }
+        else if (k == "query-cache")
+        {
+          size_t q (l.rfind (' ')); assert (q != string::npos);
+          string d (l, p + 2, q - p - 2); trim (d);
+          string f (l, q + 1); trim (f);
+
+          qc = dir_path (move (d));
+          s.query_cache_entries_.push_back (path (move (f)));
+        }
         else
           fail << "unknown keyword '" << k << "' in simulation description";
       }
@@ -331,6 +349,20 @@ namespace bpkg
                                        false   /* offline */);
       m.simulate_ = &s;
 
+      if (!qc.empty ())
+        m.enable_query_cache (qc);
+
+      // Prefetch the status of all the packages, if requested.
+      //
+      if (prefetch)
+      {
+        vector<pair<package_name, available_packages>> ps;
+        for (const string& n: qps)
+          ps.emplace_back (package_name (n), aps[n]);
+
+        m.status_prefetch (ps);
+      }
+
       // Query each package.
       //
       for (const string& n: qps)
@@ -297,6 +297,11 @@ namespace bpkg
   //
   // For the semantics of the modify_system argument see dnf_common().
   //
+  // If all the packages have been prefetched (see status_prefetch()) or
+  // their information has been cached by the previous runs for the current
+  // state of the system package database (see enable_query_cache()), then
+  // return the cached information instead.
+  //
   void system_package_manager_fedora::
   dnf_list (vector<package_info>& pis, bool modify_system, size_t n)
   {
@@ -305,6 +310,74 @@ namespace bpkg
 
     assert (n != 0 && n <= pis.size ());
 
+    if (!info_cache_.empty () &&
+        all_of (pis.begin (), pis.begin () + n,
+                [this] (const package_info& pi)
+                {
+                  return info_cache_.find (pi.name) != info_cache_.end ();
+                }))
+    {
+      for (size_t i (0); i != n; ++i)
+      {
+        package_info& pi (pis[i]);
+        const package_info& ci (info_cache_.find (pi.name)->second);
+
+        pi.installed_version = ci.installed_version;
+        pi.candidate_version = ci.candidate_version;
+        pi.installed_arch    = ci.installed_arch;
+        pi.candidate_arch    = ci.candidate_arch;
+      }
+
+      return;
+    }
+
+    // Each result in the persistent cache has the '<installed-version>
+    // <candidate-version> <installed-arch> <candidate-arch>' form.
+    //
+    optional<string> stamp;
+    if (query_cache_ && (stamp = query_cache_->stamp ()))
+    {
+      vector<strings> rs;
+      for (size_t i (0); i != n; ++i)
+      {
+        const string* r (query_cache_->find (*stamp, pis[i].name));
+
+        if (r == nullptr)
+          break;
+
+        strings fs;
+        for (size_t b (0), e; ; b = e + 1)
+        {
+          e = r->find (' ', b);
+          fs.push_back (string (*r, b, e != string::npos ? e - b : e));
+
+          if (e == string::npos)
+            break;
+        }
+
+        if (fs.size () != 4)
+          break;
+
+        rs.push_back (move (fs));
+      }
+
+      if (rs.size () == n)
+      {
+        for (size_t i (0); i != n; ++i)
+        {
+          package_info& pi (pis[i]);
+          strings& fs (rs[i]);
+
+          pi.installed_version = move (fs[0]);
+          pi.candidate_version = move (fs[1]);
+          pi.installed_arch    = move (fs[2]);
+          pi.candidate_arch    = move (fs[3]);
+        }
+
+        return;
+      }
+    }
+
     // Note that it is preferable to run dnf-list specifying --cacheonly
     // option to avoid any network interaction for the performance reasons and
     // to make the function usable in the offline mode. That, however, may not
@@ -789,6 +862,22 @@ namespace bpkg
         pi.candidate_arch = pi.installed_arch;
       }
     }
+
+    if (stamp)
+    {
+      vector<pair<string, string>> rs;
+      for (size_t i (0); i != n; ++i)
+      {
+        const package_info& pi (pis[i]);
+        rs.emplace_back (pi.name,
+                         pi.installed_version + ' ' +
+                         pi.candidate_version + ' ' +
+                         pi.installed_arch    + ' ' +
+                         pi.candidate_arch);
+      }
+
+      query_cache_->insert (*stamp, move (rs));
+    }
   }
 
   // Execute `dnf repoquery --providers-of=requires` (`dnf repoquery
@@ -833,6 +922,33 @@ namespace bpkg
     //
     string spec (name + '-' + ver + '.' + qarch);
 
+    // Each result in the persistent cache (see dnf_list() for background)
+    // has the '<name> <version>...' form. Note that the RPM package names
+    // cannot contain ':' and so the key cannot clash with the package
+    // names.
+    //
+    string key ("requires:" + spec + (installed ? ":installed" : ""));
+
+    optional<string> stamp;
+    if (query_cache_ && (stamp = query_cache_->stamp ()))
+    {
+      if (const string* c = query_cache_->find (*stamp, key))
+      {
+        strings fs;
+        for (size_t b (0), e (0), n; (n = next_word (*c, b, e, ' ')) != 0; )
+          fs.push_back (string (*c, b, n));
+
+        if (fs.size () % 2 == 0)
+        {
+          vector<pair<string, string>> r;
+          for (size_t i (0); i != fs.size (); i += 2)
+            r.emplace_back (move (fs[i]), move (fs[i + 1]));
+
+          return r;
+        }
+      }
+    }
+
     strings args_storage;
     pair<cstrings, const process_path&> args_pp (
       dnf_common ("repoquery",
@@ -1093,6 +1209,22 @@ namespace bpkg
       throw failed ();
     }
 
+    if (stamp)
+    {
+      string v;
+      for (const pair<string, string>& d: r)
+      {
+        if (!v.empty ())
+          v += ' ';
+
+        v += d.first;
+        v += ' ';
+        v += d.second;
+      }
+
+      query_cache_->insert (*stamp, {make_pair (move (key), move (v))});
+    }
+
     return r;
   }
 
@@ -1600,6 +1732,240 @@ namespace bpkg
     }
   }
 
+  // Translate the bpkg package name to the Fedora package names and return
+  // the resulting list of candidate packages, which is never empty.
+  //
+  auto system_package_manager_fedora::
+  status_candidates (const package_name& pn,
+                     const available_packages& aps,
+                     bool need_doc,
+                     bool need_debuginfo,
+                     bool need_debugsource) const -> vector<package_status>
+  {
+    vector<package_status> candidates;
+
+    auto df = make_diag_frame (
+      [this, &pn] (diag_record& dr)
+      {
+        dr << info << "while mapping " << pn << " to " << os_release.name_id
+           << " package name";
+      });
+
+    // Without explicit type, the best we can do in trying to detect whether
+    // this is a library is to check for the lib prefix. Libraries without
+    // the lib prefix and non-libraries with the lib prefix (both of which
+    // we do not recomment) will have to provide a manual mapping (or
+    // explicit type).
+    //
+    // Note that using the first (latest) available package as a source of
+    // type information seems like a reasonable choice.
+    //
+    const string& pt (!aps.empty ()
+                      ? aps.front ().first->effective_type ()
+                      : package_manifest::effective_type (nullopt, pn));
+
+    strings ns;
+    if (!aps.empty ())
+      ns = system_package_names (aps,
+                                 os_release.name_id,
+                                 os_release.version_id,
+                                 os_release.like_ids,
+                                 true /* native */);
+    if (ns.empty ())
+    {
+      // Attempt to automatically translate our package name. Failed that we
+      // should try to use the project name, if present, as a fallback.
+      //
+      const string& n (pn.string ());
+
+      // Note that theoretically different available packages can have
+      // different project names. But taking it from the latest version
+      // feels good enough.
+      //
+      const shared_ptr<available_package>& ap (!aps.empty ()
+                                               ? aps.front ().first
+                                               : nullptr);
+
+      string f (ap != nullptr && ap->project && *ap->project != pn
+                ? ap->project->string ()
+                : empty_string);
+
+      if (pt == "lib")
+      {
+        // If there is no project name let's try to use the package name
+        // with the lib prefix stripped as a fallback. Note that naming
+        // library packages without the lib prefix is quite common in Fedora
+        // (xerces-c, uuid-c++, etc).
+        //
+        if (f.empty ())
+          f = string (n, 3);
+
+        f += "-devel";
+
+        // Keep the base package name empty as an indication that it is to
+        // be discovered.
+        //
+        candidates.push_back (package_status ("", n + "-devel", move (f)));
+      }
+      else
+        candidates.push_back (package_status (n, "", move (f)));
+    }
+    else
+    {
+      // Parse each manual mapping.
+      //
+      for (const string& n: ns)
+      {
+        package_status s (parse_name_value (pt,
+                                            n,
+                                            need_doc,
+                                            need_debuginfo,
+                                            need_debugsource));
+
+        // Suppress duplicates for good measure based on the base package
+        // name (and falling back to -devel if empty).
+        //
+        auto i (find_if (candidates.begin (), candidates.end (),
+                         [&s] (const package_status& x)
+                         {
+                           // Note that it's possible for one mapping to be
+                           // specified as -devel only while the other as
+                           // main and -devel.
+                           //
+                           return s.main.empty () || x.main.empty ()
+                                  ? s.devel == x.devel
+                                  : s.main == x.main;
+                         }));
+        if (i == candidates.end ())
+          candidates.push_back (move (s));
+        else
+        {
+           // Should we verify the rest matches for good measure? But what
+           // if we need to override, as in:
+           //
+           // fedora_35-name: libfoo libfoo-bar-devel
+           // fedora_34-name: libfoo libfoo-devel
+           //
+           // Note that for this to work we must get fedora_35 values before
+           // fedora_34, which is the semantics guaranteed by
+           // system_package_names().
+        }
+      }
+    }
+
+    return candidates;
+  }
+
+  // Add the package components to query the information for to the
+  // candidate package information list.
+  //
+  static void
+  add_package_infos (package_status& ps,
+                     bool need_doc,
+                     bool need_debuginfo,
+                     bool need_debugsource)
+  {
+    vector<package_status::package_info>& pis (ps.package_infos);
+
+    if (!ps.main.empty ())            pis.emplace_back (ps.main);
+    if (!ps.devel.empty ())           pis.emplace_back (ps.devel);
+    if (!ps.fallback.empty ())        pis.emplace_back (ps.fallback);
+    if (!ps.static_.empty ())         pis.emplace_back (ps.static_);
+    if (!ps.doc.empty () && need_doc) pis.emplace_back (ps.doc);
+
+    if (!ps.debuginfo.empty () && need_debuginfo)
+      pis.emplace_back (ps.debuginfo);
+
+    if (!ps.debugsource.empty () && need_debugsource)
+      pis.emplace_back (ps.debugsource);
+
+    if (!ps.common.empty () && false) pis.emplace_back (ps.common);
+    ps.package_infos_main = pis.size ();
+    for (const string& n: ps.extras)  pis.emplace_back (n);
+  }
+
+  void system_package_manager_fedora::
+  enable_query_cache (const dir_path& d)
+  {
+    // The installed packages are recorded in the RPM database (SQLite in the
+    // recent versions and Berkeley DB in the older ones) while the available
+    // packages are determined by the repositories metadata cached by dnf
+    // (dnf5 and older versions use different cache locations).
+    //
+    // Note that the user-specific metadata cache (used if dnf runs without
+    // sudo) is not tracked. However, we only run dnf without sudo if we are
+    // not installing, in which case the candidate versions are not used
+    // (see dnf_common() and status() for details).
+    //
+    query_cache_ = system_package_query_cache (
+      d / path ("fedora-dnf-list.txt"),
+      (simulate_ != nullptr
+       ? simulate_->query_cache_entries_
+       : paths {dir_path ("/var/lib/rpm"),
+                path ("/var/lib/rpm/rpmdb.sqlite"),
+                path ("/var/lib/rpm/Packages"),
+                dir_path ("/var/cache/dnf"),
+                dir_path ("/var/cache/libdnf5")}),
+      os_release.name_id + '_' + os_release.version_id + ' ' + arch);
+  }
+
+  void system_package_manager_fedora::
+  status_prefetch (const vector<pair<package_name, available_packages>>& ps)
+  {
+    // Note: should be consistent with status() below.
+    //
+    bool need_doc (false);
+    bool need_debuginfo (false);
+    bool need_debugsource (false);
+
+    // Collect the components of all the candidate packages (including the
+    // fallback packages) for all the not yet cached bpkg packages,
+    // suppressing duplicates, and query them with a single dnf invocation.
+    //
+    // Note that the main packages which are yet to be discovered (see
+    // status() for details) are not covered and are still queried
+    // individually.
+    //
+    vector<package_info> pis;
+
+    for (const auto& p: ps)
+    {
+      if (status_cache_.find (p.first) != status_cache_.end ())
+        continue;
+
+      for (package_status& c: status_candidates (p.first,
+                                                 p.second,
+                                                 need_doc,
+                                                 need_debuginfo,
+                                                 need_debugsource))
+      {
+        add_package_infos (c, need_doc, need_debuginfo, need_debugsource);
+
+        for (package_info& pi: c.package_infos)
+        {
+          if (info_cache_.find (pi.name) == info_cache_.end () &&
+              find_if (pis.begin (), pis.end (),
+                       [&pi] (const package_info& x)
+                       {
+                         return x.name == pi.name;
+                       }) == pis.end ())
+            pis.push_back (move (pi));
+        }
+      }
+    }
+
+    if (!pis.empty ())
+    {
+      dnf_list (pis, install_);
+
+      for (package_info& pi: pis)
+      {
+        string n (pi.name);
+        info_cache_.emplace (move (n), move (pi));
+      }
+    }
+  }
+
   optional<const system_package_status*> system_package_manager_fedora::
   status (const package_name& pn, const available_packages* aps)
   {
@@ -1637,120 +2003,12 @@ namespace bpkg
     bool need_debuginfo (false);
     bool need_debugsource (false);
 
-    vector<package_status> candidates;
-
-    // Translate our package name to the Fedora package names.
-    //
-    {
-      auto df = make_diag_frame (
-        [this, &pn] (diag_record& dr)
-        {
-          dr << info << "while mapping " << pn << " to " << os_release.name_id
-             << " package name";
-        });
-
-      // Without explicit type, the best we can do in trying to detect whether
-      // this is a library is to check for the lib prefix. Libraries without
-      // the lib prefix and non-libraries with the lib prefix (both of which
-      // we do not recomment) will have to provide a manual mapping (or
-      // explicit type).
-      //
-      // Note that using the first (latest) available package as a source of
-      // type information seems like a reasonable choice.
-      //
-      const string& pt (!aps.empty ()
-                        ? aps.front ().first->effective_type ()
-                        : package_manifest::effective_type (nullopt, pn));
-
-      strings ns;
-      if (!aps.empty ())
-        ns = system_package_names (aps,
-                                   os_release.name_id,
-                                   os_release.version_id,
-                                   os_release.like_ids,
-                                   true /* native */);
-      if (ns.empty ())
-      {
-        // Attempt to automatically translate our package name. Failed that we
-        // should try to use the project name, if present, as a fallback.
-        //
-        const string& n (pn.string ());
-
-        // Note that theoretically different available packages can have
-        // different project names. But taking it from the latest version
-        // feels good enough.
-        //
-        const shared_ptr<available_package>& ap (!aps.empty ()
-                                                 ? aps.front ().first
-                                                 : nullptr);
-
-        string f (ap != nullptr && ap->project && *ap->project != pn
-                  ? ap->project->string ()
-                  : empty_string);
-
-        if (pt == "lib")
-        {
-          // If there is no project name let's try to use the package name
-          // with the lib prefix stripped as a fallback. Note that naming
-          // library packages without the lib prefix is quite common in Fedora
-          // (xerces-c, uuid-c++, etc).
-          //
-          if (f.empty ())
-            f = string (n, 3);
-
-          f += "-devel";
-
-          // Keep the base package name empty as an indication that it is to
-          // be discovered.
-          //
-          candidates.push_back (package_status ("", n + "-devel", move (f)));
-        }
-        else
-          candidates.push_back (package_status (n, "", move (f)));
-      }
-      else
-      {
-        // Parse each manual mapping.
-        //
-        for (const string& n: ns)
-        {
-          package_status s (parse_name_value (pt,
-                                              n,
-                                              need_doc,
-                                              need_debuginfo,
-                                              need_debugsource));
-
-          // Suppress duplicates for good measure based on the base package
-          // name (and falling back to -devel if empty).
-          //
-          auto i (find_if (candidates.begin (), candidates.end (),
-                           [&s] (const package_status& x)
-                           {
-                             // Note that it's possible for one mapping to be
-                             // specified as -devel only while the other as
-                             // main and -devel.
-                             //
-                             return s.main.empty () || x.main.empty ()
-                                    ? s.devel == x.devel
-                                    : s.main == x.main;
-                           }));
-          if (i == candidates.end ())
-            candidates.push_back (move (s));
-          else
-          {
-             // Should we verify the rest matches for good measure? But what
-             // if we need to override, as in:
-             //
-             // fedora_35-name: libfoo libfoo-bar-devel
-             // fedora_34-name: libfoo libfoo-devel
-             //
-             // Note that for this to work we must get fedora_35 values before
-             // fedora_34, which is the semantics guaranteed by
-             // system_package_names().
-          }
-        }
-      }
-    }
+    vector<package_status> candidates (
+      status_candidates (pn,
+                         aps,
+                         need_doc,
+                         need_debuginfo,
+                         need_debugsource));
 
     // Guess unknown main package given the -devel package, its version, and
     // architecture. Failed that, assume the package to be a binless library
@@ -1837,21 +2095,7 @@ namespace bpkg
         // Query both main and fallback packages with a single dns_list()
         // invocation.
         //
-        if (!ps.main.empty ())            pis.emplace_back (ps.main);
-        if (!ps.devel.empty ())           pis.emplace_back (ps.devel);
-        if (!ps.fallback.empty ())        pis.emplace_back (ps.fallback);
-        if (!ps.static_.empty ())         pis.emplace_back (ps.static_);
-        if (!ps.doc.empty () && need_doc) pis.emplace_back (ps.doc);
-
-        if (!ps.debuginfo.empty () && need_debuginfo)
-          pis.emplace_back (ps.debuginfo);
-
-        if (!ps.debugsource.empty () && need_debugsource)
-          pis.emplace_back (ps.debugsource);
-
-        if (!ps.common.empty () && false) pis.emplace_back (ps.common);
-        ps.package_infos_main = pis.size ();
-        for (const string& n: ps.extras)  pis.emplace_back (n);
+        add_package_infos (ps, need_doc, need_debuginfo, need_debugsource);
 
         dnf_list (pis, install_);
 
@@ -1967,6 +2211,26 @@ namespace bpkg
       {
         dnf_makecache (true /* modify_system */);
         fetched_ = true;
+
+        // Since the candidate versions may have changed, re-query the
+        // prefetched packages, if any, with a single dnf invocation.
+        //
+        if (!info_cache_.empty ())
+        {
+          vector<package_info> pis;
+          for (auto& p: info_cache_)
+            pis.push_back (move (p.second));
+
+          info_cache_.clear ();
+
+          dnf_list (pis, true /* modify_system */);
+
+          for (package_info& pi: pis)
+          {
+            string n (pi.name);
+            info_cache_.emplace (move (n), move (pi));
+          }
+        }
       }
 
       {
@@ -2217,6 +2481,10 @@ namespace bpkg
     assert (install_ && !installed_);
     installed_ = true;
 
+    // The prefetched information becomes stale once we install anything.
+    //
+    info_cache_.clear ();
+
     // Collect and merge all the Fedora packages/versions for the specified
     // bpkg packages.
     //
@@ -200,6 +200,13 @@ namespace bpkg
     virtual optional<const system_package_status*>
     status (const package_name&, const available_packages*) override;
 
+    virtual void
+    status_prefetch (
+      const vector<pair<package_name, available_packages>>&) override;
+
+    virtual void
+    enable_query_cache (const dir_path&) override;
+
     virtual void
     install (const vector<package_name>&) override;
 
@@ -365,6 +372,12 @@ namespace bpkg
       bool dnf_makecache_fail_ = false;
       bool dnf_install_fail_ = false;
       bool dnf_mark_install_fail_ = false;
+
+      // Filesystem entries to stamp the persistent query cache with instead
+      // of the system package database (see enable_query_cache() for
+      // details).
+      //
+      paths query_cache_entries_;
     };
 
     const simulation* simulate_ = nullptr;
@@ -373,12 +386,29 @@ namespace bpkg
     optional<system_package_status_fedora>
     status (const package_name&, const available_packages&);
 
+    vector<package_status>
+    status_candidates (const package_name&,
+                       const available_packages&,
+                       bool,
+                       bool,
+                       bool) const;
+
   private:
     bool fetched_ = false;   // True if already fetched metadata.
     bool installed_ = false; // True if already installed.
 
     std::map<package_name, optional<system_package_status_fedora>> status_cache_;
 
+    // Installed and candidate versions of the prefetched Fedora packages (see
+    // status_prefetch() for details).
+    //
+    std::map<string, package_info> info_cache_;
+
+    // Persistent cache of the dnf list and repoquery results (see
+    // enable_query_cache() for details).
+    //
+    optional<system_package_query_cache> query_cache_;
+
     const pkg_bindist_options* ops_ = nullptr; // Only for production.
   };
 }
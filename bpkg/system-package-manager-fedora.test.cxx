@@ -41,7 +41,8 @@ namespace bpkg
   //
   //   map-package                                manifest comes from stdin
   //
-  //   build <query-pkg>... [--install [--no-fetch] <install-pkg>...]
+  //   build <query-pkg>... [--prefetch]
+  //         [--install [--no-fetch] <install-pkg>...]
   //
   // The stdin of the build command is used to read the simulation description
   // which consists of lines in the following forms (blanks are ignored):
@@ -67,6 +68,11 @@ namespace bpkg
   //
   //   Values for simulation::dnf_{makecache,install,mark_install}_fail_.
   //
+  // query-cache: <dir> <file>
+  //
+  //   Enable the persistent query cache in <dir>, stamping it with <file>
+  //   (see simulation::query_cache_entries_ for details).
+  //
   // While creating the system package manager always pretend to be the x86_64
   // Fedora host (x86_64-redhat-linux-gnu), regardless of the actual host
   // platform.
@@ -255,8 +261,9 @@ namespace bpkg
         qps.push_back (move (a));
       }
 
-      // Parse --install [--no-fetch]
+      // Parse [--prefetch] --install [--no-fetch]
       //
+      bool prefetch (false);
       bool install (false);
       bool fetch (true);
 
@@ -264,7 +271,8 @@ namespace bpkg
       {
         string a (argv[argi]);
 
-        if (a == "--install") install = true;
+        if (a == "--prefetch") prefetch = true;
+        else if (a == "--install") install = true;
         else if (a == "--no-fetch") fetch = false;
         else break;
       }
@@ -272,6 +280,7 @@ namespace bpkg
       // Parse the description.
       //
       system_package_manager_fedora::simulation s;
+      dir_path qc; // Query cache directory.
 
       for (string l; !eof (getline (cin, l)); )
       {
@@ -351,6 +360,15 @@ namespace bpkg
         {
           s.dnf_mark_install_fail_ = true;
         }
+        else if (k == "query-cache")
+        {
+          size_t q (l.rfind (' ')); assert (q != string::npos);
+          string d (l, p + 2, q - p - 2); trim (d);
+          string f (l, q + 1); trim (f);
+
+          qc = dir_path (move (d));
+          s.query_cache_entries_.push_back (path (move (f)));
+        }
         else
           fail << "unknown keyword '" << k << "' in simulation description";
       }
@@ -377,6 +395,20 @@ namespace bpkg
                                        false   /* offline */);
       m.simulate_ = &s;
 
+      if (!qc.empty ())
+        m.enable_query_cache (qc);
+
+      // Prefetch the status of all the packages, if requested.
+      //
+      if (prefetch)
+      {
+        vector<pair<package_name, available_packages>> ps;
+        for (const string& n: qps)
+          ps.emplace_back (package_name (n), aps[n]);
+
+        m.status_prefetch (ps);
+      }
+
       // Query each package.
       //
       for (const string& n: qps)
@@ -6,6 +6,7 @@
 #include <sstream>
 
 #include <libbutl/regex.hxx>
+#include <libbutl/filesystem.hxx> // file_mtime(), dir_mtime(), mvfile()
 #include <libbutl/semantic-version.hxx>
 #include <libbutl/json/parser.hxx>
 
@@ -32,6 +33,163 @@ namespace bpkg
     // vtable
   }
 
+  void system_package_manager::
+  status_prefetch (const vector<pair<package_name, available_packages>>&)
+  {
+  }
+
+  void system_package_manager::
+  enable_query_cache (const dir_path&)
+  {
+  }
+
+  // system_package_query_cache
+  //
+  // The cache file starts with the stamp line followed by the
+  // '<key> <result>' lines.
+  //
+  system_package_query_cache::
+  system_package_query_cache (path f, paths es, string s)
+      : file_ (move (f)), entries_ (move (es)), salt_ (move (s))
+  {
+  }
+
+  optional<string> system_package_query_cache::
+  stamp () const
+  {
+    string r (salt_);
+
+    try
+    {
+      for (const path& e: entries_)
+      {
+        timestamp t (e.to_directory ()
+                     ? dir_mtime (path_cast<dir_path> (e))
+                     : file_mtime (e));
+
+        r += ' ';
+        r += to_string (t.time_since_epoch ().count ());
+      }
+    }
+    catch (const system_error&)
+    {
+      return nullopt;
+    }
+
+    return r;
+  }
+
+  void system_package_query_cache::
+  load ()
+  {
+    loaded_ = true;
+
+    // Only warn about the read errors, since the cache is only an
+    // optimization.
+    //
+    if (exists (file_, true /* ignore_error */))
+    {
+      try
+      {
+        ifdstream is (file_);
+
+        string l;
+        if (!eof (getline (is, l)))
+        {
+          stamp_ = move (l);
+
+          while (!eof (getline (is, l)))
+          {
+            size_t p (l.find (' '));
+            if (p != string::npos)
+              results_.emplace (string (l, 0, p), string (l, p + 1));
+          }
+        }
+
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        warn << "unable to read from " << file_ << ": " << e;
+
+        stamp_.clear ();
+        results_.clear ();
+      }
+    }
+  }
+
+  const string* system_package_query_cache::
+  find (const string& s, const string& k)
+  {
+    if (!loaded_)
+      load ();
+
+    if (s != stamp_)
+      return nullptr;
+
+    auto i (results_.find (k));
+    return i != results_.end () ? &i->second : nullptr;
+  }
+
+  void system_package_query_cache::
+  insert (const string& s, vector<pair<string, string>>&& rs)
+  {
+    if (!loaded_)
+      load ();
+
+    if (s != stamp_)
+    {
+      stamp_ = s;
+      results_.clear ();
+    }
+
+    for (pair<string, string>& r: rs)
+      results_[move (r.first)] = move (r.second);
+
+    // Write to the process-specific temporary file and atomically move it
+    // into place.
+    //
+    path t (file_ + ('.' + to_string (process::current_id ()) + ".tmp"));
+
+    try
+    {
+      try_mkdir_p (file_.directory ());
+    }
+    catch (const system_error& e)
+    {
+      warn << "unable to create directory " << file_.directory () << ": "
+           << e;
+      return;
+    }
+
+    try
+    {
+      auto_rmfile rm (t);
+
+      ofdstream os (t);
+
+      os << stamp_ << '\n';
+
+      for (const auto& r: results_)
+        os << r.first << ' ' << r.second << '\n';
+
+      os.close ();
+
+      mvfile (t, file_,
+              cpflags::overwrite_content | cpflags::overwrite_permissions);
+
+      rm.cancel ();
+    }
+    catch (const io_error& e)
+    {
+      warn << "unable to write to " << t << ": " << e;
+    }
+    catch (const system_error& e)
+    {
+      warn << "unable to move " << t << " to " << file_ << ": " << e;
+    }
+  }
+
   static optional<os_release>
   host_release (const target_triplet& host)
   try
@@ -59,6 +217,7 @@ namespace bpkg
 
   unique_ptr<system_package_manager>
   make_consumption_system_package_manager (const common_options& co,
+                                           const database* db,
                                            const target_triplet& host,
                                            const string& name,
                                            const string& arch,
@@ -137,6 +296,15 @@ namespace bpkg
         fail << "unsupported package manager '" << name << "' for host "
              << host;
     }
+    else
+    {
+      // Cache the query results across runs if fetch caching is enabled.
+      //
+      fetch_cache fc (co, db);
+
+      if (fc.enabled ())
+        r->enable_query_cache (fc.system_package_directory ());
+    }
 
     return r;
   }
@@ -4,6 +4,8 @@
 #ifndef BPKG_SYSTEM_PACKAGE_MANAGER_HXX
 #define BPKG_SYSTEM_PACKAGE_MANAGER_HXX
 
+#include <map>
+
 #include <bpkg/types.hxx>
 #include <bpkg/utility.hxx>
 
@@ -104,6 +106,62 @@ namespace bpkg
     status_type status = not_installed;
   };
 
+  // Persistent cache of the system package manager query results.
+  //
+  // The results are stored in a text file as opaque strings keyed by
+  // space-free strings (normally the system package names) and are only
+  // valid for a specific state of the system package database, identified
+  // by the stamp. The stamp is derived from the modification times of the
+  // specified filesystem entries (normally the package database and the
+  // repositories metadata) plus the implementation-specific salt
+  // (distribution version, architecture, etc). If the stamp changes, then
+  // all the cached results are discarded.
+  //
+  // Note that the cache file can be shared by multiple processes. It is
+  // updated atomically and the last writer wins.
+  //
+  class system_package_query_cache
+  {
+  public:
+    // The directory entries (as opposed to files) should be specified as
+    // dir_path.
+    //
+    system_package_query_cache (path file, paths entries, string salt);
+
+    // Return the current stamp or nullopt if it cannot be determined, in
+    // which case the cache should not be used.
+    //
+    // Note that the stamp should be obtained before performing the query
+    // since the system package database may change during the query.
+    //
+    optional<string>
+    stamp () const;
+
+    // Return the cached result for the key or NULL if there is none or the
+    // cached results don't correspond to the specified stamp.
+    //
+    const string*
+    find (const string& stamp, const string& key);
+
+    // Cache the key/result pairs and save the cache file.
+    // Issue a warning if unable to save.
+    //
+    void
+    insert (const string& stamp, vector<pair<string, string>>&&);
+
+  private:
+    void
+    load ();
+
+    path   file_;
+    paths  entries_;
+    string salt_;
+
+    bool loaded_ = false;
+    string stamp_; // Stamp the results correspond to.
+    std::map<string, string> results_;
+  };
+
   // As mentioned above the system package manager API has two parts:
   // consumption (status() and install()) and production (generate()) and a
   // particular implementation may only implement one, the other, or both. If
@@ -135,6 +193,30 @@ namespace bpkg
     virtual optional<const system_package_status*>
     status (const package_name&, const available_packages*) = 0;
 
+    // Prepare for querying the status of the specified packages.
+    //
+    // If the caller knows up front the set of packages it is about to query
+    // the status of, then calling this function allows the implementation to
+    // query the underlying system package manager for all of them at once
+    // rather than package by package, which can be expensive (spawning the
+    // package manager process, loading its metadata, etc). Already cached
+    // packages are ignored. Calling this function is optional and the
+    // subsequent status() calls still need to be made, in the full mode.
+    //
+    // The default implementation does nothing.
+    //
+    virtual void
+    status_prefetch (const vector<pair<package_name, available_packages>>&);
+
+    // Cache the system package manager query results across runs in the
+    // specified directory (see system_package_query_cache for details).
+    // Should be called before any status() calls.
+    //
+    // The default implementation does nothing.
+    //
+    virtual void
+    enable_query_cache (const dir_path&);
+
     // Install the specified subset of the previously-queried packages.
     // Should only be called if installation is enabled (see the constructor
     // below).
@@ -448,8 +530,13 @@ namespace bpkg
   // Note: the name can be used to select an alternative package manager
   // implementation on platforms that support multiple.
   //
+  // The database, if not NULL, is used to determine the configuration-
+  // specific fetch cache settings which affect the query results caching
+  // (see fetch_cache for details).
+  //
   unique_ptr<system_package_manager>
   make_consumption_system_package_manager (const common_options&,
+                                           const database*,
                                            const target_triplet&,
                                            const string& name,
                                            const string& arch,
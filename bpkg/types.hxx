@@ -17,9 +17,13 @@
 #include <atomic>
 
 #ifndef LIBBUTL_MINGW_STDTHREAD
+#  include <mutex>
 #  include <thread>
+#  include <condition_variable>
 #else
+#  include <libbutl/mingw-mutex.hxx>
 #  include <libbutl/mingw-thread.hxx>
+#  include <libbutl/mingw-condition_variable.hxx>
 #endif
 
 #include <ios>           // ios_base::failure
@@ -83,9 +87,19 @@ namespace bpkg
   using std::memory_order_release;
 
 #ifndef LIBBUTL_MINGW_STDTHREAD
+  using std::mutex;
+  using mlock = std::unique_lock<mutex>;
+
+  using std::condition_variable;
+
   using std::thread;
   namespace this_thread = std::this_thread;
 #else // LIBBUTL_MINGW_STDTHREAD
+  using mingw_stdthread::mutex;
+  using mlock = mingw_stdthread::unique_lock<mutex>;
+
+  using mingw_stdthread::condition_variable;
+
   using mingw_stdthread::thread;
   namespace this_thread = mingw_stdthread::this_thread;
 #endif
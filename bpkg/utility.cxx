@@ -6,6 +6,11 @@
 #include <cerrno>  // ERANGE
 #include <cstdlib> // strtoull()
 
+#ifdef __linux__
+#  include <sys/ioctl.h> // ioctl()
+#  include <linux/fs.h>  // FICLONE
+#endif
+
 #include <libbutl/prompt.hxx>
 #include <libbutl/fdstream.hxx>
 
@@ -346,6 +351,44 @@ namespace bpkg
     return true;
   }
 
+  // Try to create a copy-on-write clone (reflink) of a file, which is
+  // supported by some filesystems (btrfs, XFS, etc). Return false if that's
+  // not supported, leaving no file at the clone location.
+  //
+  static bool
+  clone_file (const path& target, const path& clone)
+  {
+#if defined(__linux__) && defined(FICLONE)
+    try
+    {
+      auto_fd in (fdopen (target, fdopen_mode::in | fdopen_mode::binary));
+
+      auto_rmfile arm (clone);
+      auto_fd out (fdopen (clone,
+                           fdopen_mode::out      |
+                           fdopen_mode::create   |
+                           fdopen_mode::truncate |
+                           fdopen_mode::binary));
+
+      if (ioctl (out.get (), FICLONE, in.get ()) == 0)
+      {
+        out.close ();
+        path_permissions (clone, path_permissions (target));
+
+        arm.cancel ();
+        return true;
+      }
+    }
+    catch (const io_error&) {}
+    catch (const system_error&) {}
+#else
+    (void) target;
+    (void) clone;
+#endif
+
+    return false;
+  }
+
   void
   hardlink (const path& target, const path& link)
   {
@@ -368,9 +411,12 @@ namespace bpkg
           auto_rmfile arm (link + ".tmp");
           const path& p (arm.path);
 
+          // Prefer cloning to copying, if supported by the filesystem.
+          //
           try
           {
-            cpfile (target, p);
+            if (!clone_file (target, p))
+              cpfile (target, p);
           }
           catch (const system_error& e)
           {
@@ -389,6 +435,21 @@ namespace bpkg
     }
   }
 
+  void
+  clone_or_hardlink (const path& target, const path& link)
+  {
+    auto_rmfile arm (link + ".tmp");
+    const path& p (arm.path);
+
+    if (clone_file (target, p))
+    {
+      mv (p, link);
+      arm.cancel ();
+    }
+    else
+      hardlink (target, link);
+  }
+
   dir_path
   change_wd (const dir_path& d)
   {
@@ -436,6 +497,7 @@ namespace bpkg
   }
 
   dir_path exec_dir;
+  strings cmd_args;
 
   const char*
   name_b (const common_options& co)
@@ -503,6 +565,42 @@ namespace bpkg
     return r;
   }
 
+  size_t
+  parallel_jobs (size_t n)
+  {
+    if (n == 0)
+    {
+      n = thread::hardware_concurrency ();
+
+      if (n == 0) // Unable to detect.
+        n = 1;
+    }
+
+    return n;
+  }
+
+  size_t
+  parallel_jobs (const common_options& co)
+  {
+    int32_t j (co.jobs ());
+
+    if (j > 0)
+      return static_cast<size_t> (j);
+
+    size_t n (parallel_jobs (0));
+
+    if (j < 0)
+    {
+      // Note that negating INT32_MIN is undefined behavior so calculate the
+      // reduction in the 64-bit space.
+      //
+      uint64_t r (-static_cast<int64_t> (j));
+      n = n > r ? n - static_cast<size_t> (r) : 1;
+    }
+
+    return n;
+  }
+
   optional<sqlite_synchronous>
   to_sqlite_synchronous (const string& v)
   {
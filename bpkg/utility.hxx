@@ -230,11 +230,21 @@ namespace bpkg
 
   // Try to create a hard link to a file and, if that fails, copy this file to
   // the link location. In the latter case, use the "write to temporary and
-  // atomically move into place" technique.
+  // atomically move into place" technique and, if supported by the
+  // filesystem (btrfs, XFS, etc), create a copy-on-write clone of the file
+  // rather than copying its content.
   //
   void
   hardlink (const path& target, const path& link);
 
+  // As above but, if supported by the filesystem, create a copy-on-write
+  // clone of the file in the first place. Unlike a hard link, such a clone
+  // doesn't share the inode with the file and thus, for example, changing
+  // the permissions of one doesn't affect the other.
+  //
+  void
+  clone_or_hardlink (const path& target, const path& link);
+
   // Set (with diagnostics at verbosity level 3 or higher) the new and return
   // the previous working directory.
   //
@@ -254,6 +264,10 @@ namespace bpkg
   //
   extern dir_path exec_dir;
 
+  // Command line arguments this process was invoked with, excluding argv[0].
+  //
+  extern strings cmd_args;
+
   // Run build2, mapping verbosity levels.
   //
   // Note that if printing own progress, then need to suppress it in build2.
@@ -309,6 +323,35 @@ namespace bpkg
   //
   optional<uint64_t>
   parse_number (const string&, uint64_t max = UINT64_MAX);
+
+  // Parallel execution.
+  //
+  // Return the number of threads to use for the specified --*-jobs option
+  // value, where 0 means the number of available hardware threads.
+  //
+  size_t
+  parallel_jobs (size_t jobs);
+
+  // Return the number of threads to use according to the --jobs option,
+  // which, if negative, reduces the number of available hardware threads.
+  // The result is never less than 1.
+  //
+  size_t
+  parallel_jobs (const common_options&);
+
+  // Call f(i) for each i in the [0, n) range using up to the specified
+  // number of threads, including the calling thread. If jobs is less than 2
+  // or there are less than 2 items, then call f() serially in the calling
+  // thread, in order.
+  //
+  // If any of the calls throws, then stop handing out the remaining items
+  // and, after all the threads are joined, rethrow the first exception in
+  // the calling thread. Note that the diagnostics issued by f() is printed
+  // as it happens (see diag_record for details).
+  //
+  template <typename F>
+  void
+  parallel_for (size_t n, size_t jobs, F&&);
 }
 
 #include <bpkg/utility.txx>
@@ -167,4 +167,79 @@ namespace bpkg
       fail << "process " << name_b (co) << " " << e;
     }
   }
+
+  // parallel_for()
+  //
+  template <typename F>
+  void
+  parallel_for (size_t n, size_t jobs, F&& f)
+  {
+    if (jobs > n)
+      jobs = n;
+
+    if (jobs < 2)
+    {
+      for (size_t i (0); i != n; ++i)
+        f (i);
+
+      return;
+    }
+
+    atomic<size_t> next (0);
+    atomic<bool> stop (false);
+
+    mutex m;
+    std::exception_ptr ex; // First exception.
+
+    auto work = [n, &f, &next, &stop, &m, &ex] ()
+    {
+      while (!stop.load (memory_order_acquire))
+      {
+        size_t i (next.fetch_add (1, memory_order_relaxed));
+
+        if (i >= n)
+          break;
+
+        try
+        {
+          f (i);
+        }
+        catch (...)
+        {
+          mlock l (m);
+
+          if (!ex)
+            ex = std::current_exception ();
+
+          stop.store (true, memory_order_release);
+        }
+      }
+    };
+
+    // Note that if we fail to start a thread, then we just continue with
+    // the already started ones (and the calling thread).
+    //
+    vector<thread> ts;
+    ts.reserve (jobs - 1);
+
+    for (size_t i (1); i != jobs; ++i)
+    {
+      try
+      {
+        ts.emplace_back (work);
+      }
+      catch (const system_error&)
+      {
+        break;
+      }
+    }
+
+    work ();
+
+    for (thread& t: ts)
+      t.join ();
+
+    if (ex)
+      std::rethrow_exception (ex);
+  }
 }
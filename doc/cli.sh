@@ -88,11 +88,11 @@ compile "pkg-bindist" $o \
 # NOTE: remember to update a similar list in buildfile and bpkg.cli as well as
 # the help topics sections in bpkg/buildfile and help.cxx.
 #
-pages="cfg-create cfg-info cfg-link cfg-unlink help pkg-checkout pkg-clean \
-pkg-configure pkg-disfigure pkg-drop pkg-fetch pkg-install pkg-purge \
-pkg-status pkg-test pkg-uninstall pkg-unpack pkg-update pkg-verify rep-add \
-rep-create rep-fetch rep-info rep-list rep-remove argument-grouping \
-default-options-files repository-signing repository-types"
+pages="cache-gc cache-info cfg-create cfg-info cfg-link cfg-unlink help \
+pkg-checkout pkg-clean pkg-configure pkg-disfigure pkg-drop pkg-fetch \
+pkg-install pkg-purge pkg-status pkg-test pkg-uninstall pkg-unpack pkg-update \
+pkg-verify rep-add rep-create rep-fetch rep-info rep-list rep-remove \
+argument-grouping default-options-files repository-signing repository-types"
 
 for p in $pages; do
   compile $p $o
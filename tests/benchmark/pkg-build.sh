@@ -0,0 +1,294 @@
+#! /usr/bin/env bash
+
+# Benchmark the pkg-build package dependency resolution on a synthetic
+# repository.
+#
+# Usage: pkg-build.sh [<options>] [-- <pkg-build-options>]
+#
+# --bpkg <path>
+#
+#   The bpkg executable to benchmark. If unspecified, then use bpkg found via
+#   PATH.
+#
+# --packages <num>
+#
+#   The number of library packages in the repository (1000 by default).
+#
+# --versions <num>
+#
+#   The number of versions of each package (5 by default).
+#
+# --builds <num>
+#
+#   The number of the topmost library packages to build (20 by default).
+#
+# --runs <num>
+#
+#   The number of timed pkg-build runs (3 by default).
+#
+# --work <dir>
+#
+#   The working directory (pkg-build-benchmark/ by default). Note that the
+#   repository is only (re-)generated if it doesn't exist or was generated
+#   with different parameters.
+#
+# --warm
+#
+#   Persist the package skeleton evaluation results with an untimed run that
+#   actually configures the packages (which are then dropped) and keep them
+#   for all the timed runs. By default they are removed before each run so
+#   that all the runs are cold. Note that the --print-only runs themselves
+#   never save these results.
+#
+# The repository contains the libb<N> library packages with the following
+# dependencies, where <N> is the package number and <V> is the version
+# number:
+#
+# - libb<N/2> >= <V-1> and libb<N/3> (diamond dependencies)
+#
+# - libb<N-1> with the require clause for every 10th package
+#
+# - libb<N-7> with the enable clause for every 7th package
+#
+# - build-time tool<K> for every 50th package (with the offset of 25), built
+#   in the linked host configuration
+#
+# The plan is only printed (--print-only) and thus nothing is actually
+# built. The wall time and the package dependency resolution profile (see
+# pkg-build --profile-file) of each run are appended to the results.jsonl
+# file in the working directory as JSON lines and the wall times are also
+# printed to stdout.
+#
+trap 'exit 1' ERR
+set -o errtrace # Trap in functions.
+
+function info () { echo "$*" 1>&2; }
+function error () { info "$*"; exit 1; }
+
+bpkg=bpkg
+packages=1000
+versions=5
+builds=20
+runs=3
+work=pkg-build-benchmark
+warm=
+ops=()
+
+while [ $# -gt 0 ]; do
+  case $1 in
+    --bpkg)
+      shift
+      bpkg="$1"
+      shift
+      ;;
+    --packages)
+      shift
+      packages="$1"
+      shift
+      ;;
+    --versions)
+      shift
+      versions="$1"
+      shift
+      ;;
+    --builds)
+      shift
+      builds="$1"
+      shift
+      ;;
+    --runs)
+      shift
+      runs="$1"
+      shift
+      ;;
+    --work)
+      shift
+      work="${1%/}"
+      shift
+      ;;
+    --warm)
+      warm=true
+      shift
+      ;;
+    --)
+      shift
+      ops=("$@")
+      break
+      ;;
+    *)
+      error "unexpected $1"
+      ;;
+  esac
+done
+
+if [ "$builds" -gt "$packages" ]; then
+  error "--builds value is greater than --packages value"
+fi
+
+tools=$(( packages / 50 ))
+if [ "$tools" -eq 0 ]; then
+  tools=1
+fi
+
+mkdir -p "$work"
+work="$(cd "$work" && pwd)"
+
+repo="$work/repo"
+params="$packages $versions"
+
+# Create the package source directory and its archive in the repository.
+#
+# Usage: package <name> <version> [<depends-value>...]
+#
+function package ()
+{
+  local n="$1"
+  local v="$2"
+  shift 2
+
+  local d="$work/src/$n-$v"
+
+  mkdir -p "$d/build"
+
+  cat <<EOF >"$d/build/bootstrap.build"
+project = $n
+using config
+EOF
+
+  cat <<EOF >"$d/build/root.build"
+config [bool] config.$n.extras ?= false
+config [bool] config.$n.feature ?= true
+EOF
+
+  echo './: manifest' >"$d/buildfile"
+
+  cat <<EOF >"$d/manifest"
+: 1
+name: $n
+version: $v
+summary: $n
+license: MIT
+url: http://example.org
+email: pkg@example.org
+EOF
+
+  local dv
+  for dv in "$@"; do
+    if [[ "$dv" == *$'\n'* ]]; then
+      printf 'depends:\n\\\n%s\n\\\n' "$dv" >>"$d/manifest"
+    else
+      echo "depends: $dv" >>"$d/manifest"
+    fi
+  done
+
+  tar -C "$work/src" -czf "$repo/$n-$v.tar.gz" "$n-$v"
+}
+
+if [ ! -f "$repo/packages.manifest" -o \
+     "$(cat "$work/params" 2>/dev/null)" != "$params" ]; then
+
+  info "generating repository with $packages packages, $versions versions each"
+
+  rm -rf "$work/src" "$repo"
+  mkdir -p "$work/src" "$repo"
+
+  echo ': 1' >"$repo/repositories.manifest"
+
+  for (( k=0; k != tools; k++ )); do
+    for (( v=1; v <= versions; v++ )); do
+      package "tool$k" "$v.0.0"
+    done
+  done
+
+  for (( i=0; i != packages; i++ )); do
+    for (( v=1; v <= versions; v++ )); do
+      deps=()
+
+      if [ "$i" -gt 1 ]; then
+        deps+=("libb$(( i / 2 )) >= $(( v > 1 ? v - 1 : 1 )).0.0")
+      fi
+
+      # Note: both are libb1 for libb3.
+      #
+      if [ "$i" -gt 3 ]; then
+        deps+=("libb$(( i / 3 ))")
+      fi
+
+      if [ "$i" -gt 0 -a $(( i % 10 )) -eq 0 ]; then
+        deps+=("libb$(( i - 1 ))
+{
+  require
+  {
+    config.libb$(( i - 1 )).extras = true
+  }
+}")
+      fi
+
+      # Note: libb7 is already a dependency of libb14.
+      #
+      if [ "$i" -gt 14 -a $(( i % 7 )) -eq 0 ]; then
+        deps+=("libb$(( i - 7 )) ? (\$config.libb$i.feature)")
+      fi
+
+      if [ $(( i % 50 )) -eq 25 ]; then
+        deps+=("* tool$(( i / 50 % tools ))")
+      fi
+
+      package "libb$i" "$v.0.0" "${deps[@]}"
+    done
+  done
+
+  "$bpkg" rep-create -q "$repo"
+
+  echo "$params" >"$work/params"
+fi
+
+# Create the target and host configurations, link them, and fetch the
+# repository.
+#
+rm -rf "$work/cfg" "$work/host"
+
+"$bpkg" cfg-create -q -d "$work/cfg"
+"$bpkg" cfg-create -q -d "$work/host" --type host
+"$bpkg" cfg-link -q -d "$work/cfg" "$work/host"
+
+"$bpkg" rep-add -q -d "$work/cfg" "$repo"
+"$bpkg" rep-fetch -q -d "$work/cfg" --trust-yes
+
+pkgs=()
+for (( i=packages - builds; i != packages; i++ )); do
+  pkgs+=("libb$i")
+done
+
+if [ -n "$warm" ]; then
+  info "warming up package skeleton evaluation results"
+
+  "$bpkg" pkg-build -d "$work/cfg" --yes --configure-only -q \
+          "${ops[@]}" "${pkgs[@]}"
+
+  "$bpkg" pkg-drop -d "$work/cfg" --yes --all -q
+fi
+
+for (( r=1; r <= runs; r++ )); do
+  if [ -z "$warm" ]; then
+    rm -f "$work/cfg/.bpkg/skeleton-cache.txt" \
+          "$work/host/.bpkg/skeleton-cache.txt"
+  fi
+
+  prof="$work/profile-$r.json"
+
+  s="$(date +%s%N)"
+
+  "$bpkg" pkg-build -d "$work/cfg" --print-only --profile-file "$prof" \
+          "${ops[@]}" "${pkgs[@]}" >/dev/null
+
+  e="$(date +%s%N)"
+
+  ms=$(( (e - s) / 1000000 ))
+
+  echo "run $r: ${ms}ms"
+
+  echo "{\"packages\": $packages, \"versions\": $versions, \
+\"builds\": $builds, \"run\": $r, \"time_ms\": $ms, \
+\"profile\": $(tr -d '\n' <"$prof")}" >>"$work/results.jsonl"
+done